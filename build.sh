@@ -1,6 +1,14 @@
 #!/bin/bash
 
+# export memory for VeRT tests (see README)
+export_memory() {
+    wasm2wat $1.wasm | sed -e 's|(memory |(memory (export "memory") |' > $1.wat
+    wat2wasm -o $1.wasm $1.wat
+    rm $1.wat
+}
+
 cdt-cpp eosio.reward.cpp -I ./include -I ./external --no-missing-ricardian-clause
-wasm2wat eosio.reward.wasm | sed -e 's|(memory |(memory (export "memory") |' > eosio.reward.wat
-wat2wasm -o eosio.reward.wasm eosio.reward.wat
-rm eosio.reward.wat
+export_memory eosio.reward
+
+cdt-cpp external/eosio.saving/eosio.saving.cpp -I ./external -o external/eosio.saving/eosio.saving.wasm --no-missing-ricardian-clause
+export_memory external/eosio.saving/eosio.saving
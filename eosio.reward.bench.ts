@@ -0,0 +1,253 @@
+import { Name } from '@wharfkit/antelope'
+import { Blockchain } from '@eosnetwork/vert'
+import { existsSync, readFileSync, statSync, writeFileSync } from 'fs'
+
+// Resource-cost benchmarks for `eosio.reward`
+//
+// usage: bun run bench [--update]
+//
+// Results are written to `bench_output.json` and compared against the budgets in
+// `eosio.reward.bench.json` (recorded with `--update`), any metric more than `TOLERANCE`
+// above its budget fails the run.
+//
+// VeRT does not bill resources, the following measurements are used instead:
+// - `cpu_us`: median wall-clock time of the transaction in the VM (microseconds, reported only,
+//   wall-clock time is too noisy to be budgeted)
+// - `action_bytes`: bytes of action data of the transaction and its inline actions (not NET, which only
+//   bills the pushed transaction, the data of inline actions costs CPU and is kept in the action traces)
+// - `inline_actions`: number of inline actions in the action trace (excluding notifications)
+// - `ram_bytes`: growth of the JSON encoded `eosio.reward` (strategies, state, stats, config, epoch and
+//   recipients) and `eosio.saving` table rows (RAM estimate)
+
+const reward_contract = 'eosio.reward'
+const saving = 'eosio.saving'
+const REPEAT = 5
+const BUDGET_FILE = 'eosio.reward.bench.json'
+const REPORT_FILE = 'bench_output.json'
+
+// relative margin above the recorded budgets (metrics are deterministic, the margin absorbs CDT/VeRT upgrades)
+const TOLERANCE = 0.05
+
+// metrics compared against budgets
+const BUDGETED: (keyof Metrics)[] = ['action_bytes', 'inline_actions', 'ram_bytes']
+
+// strategies defined in `STRATEGIES` (eosio.reward.hpp), sorted by name
+const STRATEGIES = ['eosio.bonds', 'eosio.rex', 'recipients']
+
+// number of recipients of the `recipients` strategy, around `DISTRIBUTE_BATCH_SIZE` (50)
+const RECIPIENT_COUNTS = [1, 10, 50, 51, 200]
+const letters = 'abcdefghijklmnopqrstuvwxyz'
+const RECIPIENTS = Array.from({length: Math.max(...RECIPIENT_COUNTS)}, (_, i) => `rcp${letters[Math.floor(i / 676) % 26]}${letters[Math.floor(i / 26) % 26]}${letters[i % 26]}`)
+
+const BALANCES: {[key: string]: string} = {
+    empty: '0.0000 EOS',
+    dust: '0.0001 EOS',
+    large: '1000000.0000 EOS',
+}
+
+interface Metrics {
+    cpu_us: number
+    action_bytes: number
+    inline_actions: number
+    ram_bytes: number
+}
+
+function setup() {
+    const blockchain = new Blockchain()
+    blockchain.createAccounts('eosio.rex', 'eosio.bonds', 'eosio.null', 'eosio.ram', 'eosio', ...RECIPIENTS)
+    const contracts = {
+        reward: blockchain.createContract(reward_contract, reward_contract, true),
+        token: blockchain.createContract('eosio.token', 'external/eosio.token/eosio.token', true),
+        system: blockchain.createContract('eosio', 'external/eosio.system/eosio', true),
+        saving: blockchain.createContract(saving, 'external/eosio.saving/eosio.saving', true),
+    }
+    return { blockchain, contracts }
+}
+
+async function init({ contracts }: ReturnType<typeof setup>) {
+    const supply = `2100000000.0000 EOS`
+    await contracts.system.actions.init([]).send()
+    await contracts.saving.actions.setdistrib([[{account: reward_contract, percent: 10000}]]).send()
+    await contracts.token.actions.create(['eosio.token', supply]).send()
+    await contracts.token.actions.issue(['eosio.token', supply, '']).send()
+    await contracts.token.actions.transfer(['eosio.token', 'eosio', '350000000.0000 EOS', '']).send()
+    await contracts.token.actions.open([reward_contract, '4,EOS', 'eosio.token']).send()
+}
+
+async function setRecipients({ contracts }: ReturnType<typeof setup>, count: number) {
+    for (const account of RECIPIENTS.slice(0, count)) {
+        await contracts.reward.actions.setrecipient(['recipients', account, 1]).send()
+    }
+}
+
+function epochInProgress({ contracts }: ReturnType<typeof setup>) {
+    const scope = Name.from(reward_contract).value.value
+    const epoch = contracts.reward.tables.epoch(scope).getTableRows()[0]
+    return epoch !== undefined && epoch.strategies.length > 0
+}
+
+function tableBytes({ contracts }: ReturnType<typeof setup>) {
+    let bytes = 0
+    const scope = (account: string) => Name.from(account).value.value
+    const tables = [
+        contracts.reward.tables.strategies(scope(reward_contract)),
+        contracts.reward.tables.state(scope(reward_contract)),
+        contracts.reward.tables.stats(scope(reward_contract)),
+        contracts.reward.tables.config(scope(reward_contract)),
+        contracts.reward.tables.epoch(scope(reward_contract)),
+        contracts.reward.tables.recipients(scope('recipients')),
+        contracts.reward.tables.recipstate(scope('recipients')),
+        contracts.saving.tables.claimers(scope(saving)),
+    ]
+    for (const table of tables) {
+        for (const row of table.getTableRows()) {
+            bytes += JSON.stringify(row).length
+        }
+    }
+    return bytes
+}
+
+// `error` is the assertion expected from `send`, any other outcome aborts the run
+async function measure(chain: ReturnType<typeof setup>, send: () => Promise<any>, prepare?: () => Promise<any>, error?: string): Promise<Metrics> {
+    const samples: Metrics[] = []
+    for (let i = 0; i < REPEAT; i++) {
+        // failing transactions are reverted, the prepared state is reused
+        if (prepare && (i === 0 || !error)) await prepare()
+        const ram_before = tableBytes(chain)
+        const start = performance.now()
+        let failure: string | undefined
+        try {
+            await send()
+        } catch (e) {
+            failure = (e as Error).message
+        }
+        if (error === undefined && failure !== undefined) throw new Error(`unexpected failure: ${failure}`)
+        if (error !== undefined && !failure?.includes(error)) throw new Error(`expected failure "${error}", got: ${failure ?? 'success'}`)
+        const cpu_us = Math.round((performance.now() - start) * 1000)
+        const traces = chain.blockchain.actionTraces.filter((trace: any) => !trace.isNotification)
+        samples.push({
+            cpu_us,
+            action_bytes: traces.reduce((total: number, trace: any) => total + (trace.data?.length ?? 0), 0),
+            inline_actions: traces.filter((trace: any) => trace.isInline).length,
+            ram_bytes: Math.max(0, tableBytes(chain) - ram_before),
+        })
+    }
+    // median for timings, max for deterministic counters
+    const median = samples.map(s => s.cpu_us).sort((a, b) => a - b)[Math.floor(REPEAT / 2)]
+    return {
+        cpu_us: median,
+        action_bytes: Math.max(...samples.map(s => s.action_bytes)),
+        inline_actions: Math.max(...samples.map(s => s.inline_actions)),
+        ram_bytes: Math.max(...samples.map(s => s.ram_bytes)),
+    }
+}
+
+async function run() {
+    const report: {[key: string]: Metrics | number} = {}
+    report['wasm_bytes'] = statSync(`${reward_contract}.wasm`).size
+
+    for (let count = 1; count <= STRATEGIES.length; count++) {
+        for (const [balance_case, quantity] of Object.entries(BALANCES)) {
+            for (const claim of [true, false]) {
+                const chain = setup()
+                await init(chain)
+                await setRecipients(chain, 1)
+                const { contracts } = chain
+                for (const strategy of STRATEGIES.slice(0, count)) {
+                    await contracts.reward.actions.setstrategy([strategy, 100]).send()
+                }
+                // `claim` routes funds through eosio.saving, otherwise funds are sent directly to eosio.reward
+                const to = claim ? saving : reward_contract
+                const prepare = async () => {
+                    if (quantity === BALANCES.empty) return
+                    await contracts.token.actions.transfer(['eosio', to, quantity, '']).send()
+                }
+                // a single unit is only payable to a single strategy
+                const error = quantity === BALANCES.empty ? 'no balance to distribute'
+                    : quantity === BALANCES.dust && count > 1 ? 'no strategy amount to distribute'
+                    : undefined
+                const key = `distribute/${count}/${balance_case}/${claim ? 'claim' : 'direct'}`
+                report[key] = await measure(chain, () => contracts.reward.actions.distribute([]).send(), prepare, error)
+            }
+        }
+    }
+
+    // `recipients` only, opening an epoch (first batch) and continuing it
+    for (const count of RECIPIENT_COUNTS) {
+        const chain = setup()
+        await init(chain)
+        await setRecipients(chain, count)
+        const { contracts } = chain
+        await contracts.reward.actions.setstrategy(['recipients', 100]).send()
+        const distribute = () => contracts.reward.actions.distribute([]).send()
+        const open = async () => {
+            while (epochInProgress(chain)) await distribute()
+            await contracts.token.actions.transfer(['eosio', reward_contract, BALANCES.large, '']).send()
+        }
+        report[`distribute/recipients/${count}/open`] = await measure(chain, distribute, open)
+        if (count <= 50) continue
+        const next = async () => {
+            if (epochInProgress(chain)) return
+            await open()
+            await distribute()
+        }
+        report[`distribute/recipients/${count}/continue`] = await measure(chain, distribute, next)
+    }
+
+    for (let count = 1; count <= STRATEGIES.length; count++) {
+        const chain = setup()
+        await init(chain)
+        for (const strategy of STRATEGIES.slice(0, count - 1)) {
+            await chain.contracts.reward.actions.setstrategy([strategy, 100]).send()
+        }
+        const strategy = STRATEGIES[count - 1]
+        report[`setstrategy/${count}`] = await measure(chain, () => chain.contracts.reward.actions.setstrategy([strategy, 100]).send())
+    }
+
+    writeFileSync(REPORT_FILE, JSON.stringify(report, null, 2) + '\n')
+    console.log(`report written: ${REPORT_FILE}`)
+
+    // budgets are the measured results of the deterministic metrics
+    if (process.argv.includes('--update')) {
+        const budgets: {[key: string]: Partial<Metrics> | number} = {}
+        for (const [key, result] of Object.entries(report)) {
+            if (typeof result === 'number') {
+                budgets[key] = result
+                continue
+            }
+            budgets[key] = Object.fromEntries(BUDGETED.map(metric => [metric, result[metric]]))
+        }
+        writeFileSync(BUDGET_FILE, JSON.stringify(budgets, null, 2) + '\n')
+        console.log(`budgets updated: ${BUDGET_FILE}`)
+        return
+    }
+    if (!existsSync(BUDGET_FILE)) {
+        console.error(`no budgets recorded, run \`bun run bench --update\` and commit ${BUDGET_FILE}`)
+        process.exit(1)
+    }
+
+    // compare against budgets
+    const budgets = JSON.parse(readFileSync(BUDGET_FILE, 'utf8'))
+    const exceeds = (value: number, budget: number) => value > Math.floor(budget * (1 + TOLERANCE))
+    const failures: string[] = []
+    for (const [key, result] of Object.entries(report)) {
+        const budget = budgets[key]
+        if (budget === undefined) {
+            failures.push(`${key}: no budget recorded`)
+            continue
+        }
+        if (typeof result === 'number') {
+            if (exceeds(result, budget)) failures.push(`${key}: ${result} > ${budget}`)
+            continue
+        }
+        for (const metric of BUDGETED) {
+            if (exceeds(result[metric], budget[metric])) failures.push(`${key}.${metric}: ${result[metric]} > ${budget[metric]}`)
+        }
+    }
+    if (failures.length) {
+        console.error(`budget exceeded:\n  ${failures.join('\n  ')}`)
+        process.exit(1)
+    }
+}
+
+await run()
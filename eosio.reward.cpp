@@ -10,7 +10,9 @@ void reward::setstrategy( const name strategy, const uint16_t weight ) {
 
     // validate input
     check(weight > 0, "weight must be greater than 0");
-    check(STRATEGIES.find(strategy) != STRATEGIES.end(), "strategy not defined");
+    check(find_strategy(strategy) != nullptr, "strategy not defined");
+    check_epoch_closed();
+    check(state_table( get_self(), get_self().value ).exists() || _strategies.begin() == _strategies.end(), "state not initialized, run `migrate` action first");
 
     // update weights
     auto itr = _strategies.find(strategy.value);
@@ -24,6 +26,7 @@ void reward::setstrategy( const name strategy, const uint16_t weight ) {
             row.weight = weight;
         });
     }
+    set_state_weight( strategy, weight );
 }
 
 [[eosio::action]]
@@ -34,43 +37,437 @@ void reward::delstrategy( const name strategy )
     strategies_table _strategies( get_self(), get_self().value );
     auto itr = _strategies.find(strategy.value);
     check(itr != _strategies.end(), "strategy not found");
+    check_epoch_closed();
+    check(state_table( get_self(), get_self().value ).exists(), "state not initialized, run `migrate` action first");
     _strategies.erase(itr);
+    set_state_weight( strategy, 0 );
+}
+
+[[eosio::action]]
+void reward::setrecipient( const name strategy, const name account, const uint16_t weight )
+{
+    require_auth( get_self() );
+
+    recipients_table _recipients( get_self(), strategy.value );
+
+    // validate input
+    check(weight > 0, "weight must be greater than 0");
+    const strategy_definition* definition = find_strategy(strategy);
+    check(definition != nullptr && definition->action == strategy_action::recipients, "strategy does not accept recipients");
+    check(is_account(account), "account does not exist");
+    check_epoch_closed();
+
+    // update weights
+    recipients_state_table _recipients_state( get_self(), strategy.value );
+    auto recipients_state = _recipients_state.get_or_default();
+    auto itr = _recipients.find(account.value);
+    if (itr == _recipients.end()) {
+        _recipients.emplace(get_self(), [&](auto& row) {
+            row.account = account;
+            row.weight = weight;
+        });
+    } else {
+        recipients_state.total_weight -= itr->weight;
+        _recipients.modify(itr, get_self(), [&](auto& row) {
+            row.weight = weight;
+        });
+    }
+    recipients_state.total_weight += weight;
+    _recipients_state.set( recipients_state, get_self() );
+}
+
+[[eosio::action]]
+void reward::delrecipient( const name strategy, const name account )
+{
+    require_auth( get_self() );
+
+    recipients_table _recipients( get_self(), strategy.value );
+    auto itr = _recipients.find(account.value);
+    check(itr != _recipients.end(), "recipient not found");
+    check_epoch_closed();
+
+    recipients_state_table _recipients_state( get_self(), strategy.value );
+    auto recipients_state = _recipients_state.get();
+    recipients_state.total_weight -= itr->weight;
+    _recipients_state.set( recipients_state, get_self() );
+    _recipients.erase(itr);
+}
+
+[[eosio::action]]
+void reward::setsources( const vector<name> sources )
+{
+    require_auth( get_self() );
+
+    config_table _config( get_self(), get_self().value );
+    auto config = _config.get_or_default();
+
+    for ( const name source : sources ) {
+        check(is_account(source), "account does not exist: " + source.to_string());
+        check(source != "eosio.saving"_n, "eosio.saving rewards are claimed by `distribute`");
+    }
+    config.sources = sources;
+    _config.set( config, get_self() );
+}
+
+[[eosio::action]]
+void reward::setthrottle( const uint32_t min_interval_sec, const asset min_quantity, const asset min_strategy_quantity )
+{
+    require_auth( get_self() );
+
+    config_table _config( get_self(), get_self().value );
+    auto config = _config.get_or_default();
+
+    // validate input
+    check(min_quantity.symbol == TOKEN_SYMBOL && min_quantity.amount >= 0, "invalid min_quantity");
+    check(min_strategy_quantity.symbol == TOKEN_SYMBOL && min_strategy_quantity.amount >= 0, "invalid min_strategy_quantity");
+
+    config.min_interval_sec = min_interval_sec;
+    config.min_quantity = min_quantity;
+    config.min_strategy_quantity = min_strategy_quantity;
+    config.next_distribution = time_point_sec{};
+    _config.set( config, get_self() );
 }
 
 [[eosio::action]]
 void reward::distribute()
 {
     // any authority is allowed to call this action
+    config_table _config( get_self(), get_self().value );
+    auto config = _config.get_or_default();
 
-    strategies_table _strategies( get_self(), get_self().value );
-    const uint32_t total_weight = get_total_weight();
+    // throttle before any other table reads or inline actions, continuing a distribution epoch is never throttled
+    // (`next_distribution` is only moved forward once a distribution epoch completes)
+    check(config.in_progress || time_point_sec( current_time_point() ) >= config.next_distribution, "distribution throttled");
 
-    // dispatch actions
-    eosiosystem::system_contract::donatetorex_action donatetorex( "eosio"_n, { get_self(), "active"_n });
-    eosio::token::transfer_action transfer( "eosio.token"_n, { get_self(), "active"_n });
+    epoch_table _epoch( get_self(), get_self().value );
+    auto epoch = _epoch.get_or_default();
+
+    // continue distribution epoch in progress
+    if ( epoch.in_progress() ) {
+        distribute_batch( epoch );
+        _epoch.set( epoch, get_self() );
+        set_next_distribution( config, epoch );
+        return;
+    }
+
+    // distributing rewards in EOS (liquid balance and pending eosio.saving claim)
+    const preview_result result = get_preview( config, epoch );
+    check((result.balance + result.saving_balance).amount > 0, "no balance to distribute");
+    check(result.balance + result.saving_balance >= config.min_quantity, "balance below minimum distribution");
+
+    // reject before claiming when every strategy is skipped (below `min_strategy_quantity` or no recipients)
+    check(result.dust < result.balance + result.saving_balance, "no strategy amount to distribute");
+
+    // claim available rewards from eosio.saving (`on_transfer` ignores the incoming claim)
     saving::claim_action claim( "eosio.saving"_n, { get_self(), "active"_n });
+    if ( result.saving_balance.amount ) claim.send( get_self() );
 
-    // claim available rewards from eosio.saving
-    const asset saving_balance = saving::get_balance( get_self() );
-    if ( saving_balance.amount ) claim.send( get_self() );
+    distribute_result( epoch, result );
+    set_next_distribution( config, epoch );
+}
 
-    // distributing rewards in EOS
-    const asset balance = eosio::token::get_balance( "eosio.token"_n, get_self(), symbol_code("EOS") ) + saving_balance;
-    check(balance.amount > 0, "no balance to distribute");
+[[eosio::action]]
+void reward::abortepoch()
+{
+    require_auth( get_self() );
 
-    for ( auto& row : _strategies ) {
-        const asset reward_to_distribute = balance * row.weight / total_weight;
-        if (reward_to_distribute.amount <= 0) continue; // skip if no fee to distribute
+    epoch_table _epoch( get_self(), get_self().value );
+    auto epoch = _epoch.get_or_default();
+    check(epoch.in_progress(), "no distribution epoch in progress");
+
+    // unpaid amounts remain in the liquid balance
+    for ( const paged_strategy& paged : epoch.strategies ) {
+        update_paged_stats( paged );
+    }
+    epoch.strategies.clear();
+    epoch.cursor = 0;
+    _epoch.set( epoch, get_self() );
+
+    config_table _config( get_self(), get_self().value );
+    auto config = _config.get();
+    config.in_progress = false;
+    _config.set( config, get_self() );
+}
+
+[[eosio::on_notify("eosio.token::transfer")]]
+void reward::on_transfer( const name from, const name to, const asset quantity, const string memo )
+{
+    // ignore transfers not sent to contract
+    if ( to != get_self() ) return;
+    if ( quantity.symbol != TOKEN_SYMBOL ) return;
+
+    // only transfers from sources are distributed on arrival, others are swept by `distribute`
+    // (eosio.saving only pays on `claim`, which `distribute` already accounts for)
+    config_table _config( get_self(), get_self().value );
+    auto config = _config.get_or_default();
+    if ( find( config.sources.begin(), config.sources.end(), from ) == config.sources.end() ) return;
+
+    // funds received during an epoch are swept by `distribute` once it completes
+    if ( config.in_progress ) return;
+    epoch_table _epoch( get_self(), get_self().value );
+    auto epoch = _epoch.get_or_default();
+
+    state_table _state( get_self(), get_self().value );
+    const auto state = _state.get_or_default();
+
+    preview_result result;
+    result.saving_balance = asset{0, quantity.symbol};
+    result.balance = quantity;
+    result.total_weight = state.total_weight;
+    result.strategies = get_strategy_amounts( state, quantity, config.min_strategy_quantity );
+    result.dust = quantity;
+    for ( const strategy_amount& row : result.strategies ) {
+        result.dust -= row.quantity;
+    }
+    result.in_progress = false;
+    distribute_result( epoch, result );
+
+    // `next_distribution` is left to `distribute`, only the opened epoch is recorded
+    if ( epoch.in_progress() ) {
+        config.in_progress = true;
+        _config.set( config, get_self() );
+    }
+}
+
+void reward::distribute_result( epoch_row& epoch, const preview_result& result )
+{
+    // funds are kept until strategies are defined or a strategy amount is above the minimum
+    if ( result.total_weight == 0 ) return;
+    if ( result.dust == result.balance + result.saving_balance ) return;
+
+    for ( const strategy_amount& row : result.strategies ) {
+        if (row.quantity.amount <= 0) continue; // skip if no fee to distribute
 
-        // Donate to REX
-        if ( row.strategy == "eosio.rex"_n) {
-            donatetorex.send( get_self(), reward_to_distribute, "staking rewards" );
+        const strategy_definition* definition = find_strategy( row.strategy );
+        check(definition != nullptr, "strategy not defined");
 
-        // EOS T-Bonds
-        } else if ( row.strategy == "eosio.bonds"_n) {
-            transfer.send( get_self(), "eosio.bonds"_n, reward_to_distribute, "staking rewards" );
+        // snapshot amount and total recipient weight, paid in batches
+        if ( definition->action == strategy_action::recipients ) {
+            const uint64_t total_weight = recipients_state_table( get_self(), row.strategy.value ).get().total_weight;
+            epoch.strategies.push_back({ row.strategy, row.quantity, total_weight, asset{0, row.quantity.symbol} });
+            continue;
         }
+        send_strategy( *definition, row.quantity );
+    }
+    update_stats( result );
+
+    // open distribution epoch and pay the first batch
+    if ( epoch.in_progress() ) {
+        epoch.epoch += 1;
+        epoch.cursor = 0;
+        distribute_batch( epoch );
+        epoch_table _epoch( get_self(), get_self().value );
+        _epoch.set( epoch, get_self() );
+    }
+}
+
+[[eosio::action, eosio::read_only]]
+preview_result reward::preview()
+{
+    config_table _config( get_self(), get_self().value );
+    epoch_table _epoch( get_self(), get_self().value );
+    return get_preview( _config.get_or_default(), _epoch.get_or_default() );
+}
+
+preview_result reward::get_preview( const config_row& config, const epoch_row& epoch )
+{
+    state_table _state( get_self(), get_self().value );
+    const auto state = _state.get_or_default();
+
+    preview_result result;
+    result.saving_balance = saving::get_balance( get_self() );
+    result.balance = eosio::token::get_balance( "eosio.token"_n, get_self(), symbol_code("EOS") );
+    result.total_weight = state.total_weight;
+    result.in_progress = epoch.in_progress();
+    result.dust = asset{0, result.balance.symbol};
+
+    // next `distribute` only pays the next batch of recipients (balance still holds the unpaid epoch amounts)
+    if ( result.in_progress ) return result;
+
+    // rewards are distributed from both the liquid and pending eosio.saving balances
+    const asset balance = result.balance + result.saving_balance;
+    result.strategies = get_strategy_amounts( state, balance, config.min_strategy_quantity );
+    result.dust = balance;
+    for ( const strategy_amount& row : result.strategies ) {
+        result.dust -= row.quantity;
+    }
+    return result;
+}
+
+// amounts sent to each strategy when distributing `quantity` (0 when skipped)
+vector<strategy_amount> reward::get_strategy_amounts( const state_row& state, const asset quantity, const asset min_quantity )
+{
+    vector<strategy_amount> amounts;
+    amounts.reserve( state.strategies.size() );
+
+    // recipients strategy without any recipient keeps its share
+    const auto payable = [&]( const strategy_weight& row ) {
+        const strategy_definition* definition = find_strategy( row.strategy );
+        if ( definition == nullptr || definition->action != strategy_action::recipients ) return true;
+        return recipients_state_table( get_self(), row.strategy.value ).get_or_default().total_weight > 0;
+    };
+    split::strategy_amounts( state.strategies, state.total_weight, quantity.amount, min_quantity.amount, payable, [&]( const strategy_weight& row, const int64_t amount ) {
+        amounts.push_back({ row.strategy, asset{ amount, quantity.symbol } });
+    });
+    return amounts;
+}
+
+void reward::update_stats( const preview_result& result )
+{
+    stats_table _stats( get_self(), get_self().value );
+    auto stats = _stats.get_or_default();
+
+    const asset quantity = result.balance + result.saving_balance - result.dust;
+    const asset zero = asset{0, quantity.symbol};
+    if ( stats.distributions == 0 ) stats.total_claimed = zero;
+
+    // cumulative totals per strategy (`recipients` are credited once paid, see `update_paged_stats`)
+    for ( const strategy_amount& row : result.strategies ) {
+        const strategy_definition* definition = find_strategy( row.strategy );
+        if ( definition != nullptr && definition->action == strategy_action::recipients ) continue;
+        add_stats_total( stats, row );
+    }
+    stats.distributions += 1;
+    stats.last_distribution = current_time_point();
+    stats.last_quantity = quantity;
+    stats.total_claimed += result.saving_balance;
+    stats.dust = result.dust;
+
+    // ring buffer of the last distributions, overwritten in place once full
+    const distribution_log log = { stats.last_distribution, quantity, result.saving_balance };
+    if ( stats.history.size() < STATS_HISTORY_SIZE ) stats.history.push_back( log );
+    else stats.history[stats.history_index] = log;
+    stats.history_index = (stats.history_index + 1) % STATS_HISTORY_SIZE;
+
+    _stats.set( stats, get_self() );
+}
+
+// completed or aborted `recipients` strategy, rounding dust and unpaid amounts are kept as dust
+void reward::update_paged_stats( const paged_strategy& paged )
+{
+    stats_table _stats( get_self(), get_self().value );
+    auto stats = _stats.get();
+    add_stats_total( stats, { paged.strategy, paged.paid } );
+    stats.dust += paged.quantity - paged.paid;
+    _stats.set( stats, get_self() );
+}
+
+// cumulative totals per strategy (bounded by the number of defined strategies)
+void reward::add_stats_total( stats_row& stats, const strategy_amount& amount )
+{
+    if ( amount.quantity.amount <= 0 ) return;
+    auto itr = lower_bound( stats.totals.begin(), stats.totals.end(), amount.strategy, []( const strategy_amount& total, const name strategy ) {
+        return total.strategy < strategy;
+    });
+    if ( itr == stats.totals.end() || itr->strategy != amount.strategy ) itr = stats.totals.insert(itr, { amount.strategy, asset{0, amount.quantity.symbol} });
+    itr->quantity += amount.quantity;
+}
+
+void reward::send_strategy( const strategy_definition& definition, const asset quantity )
+{
+    switch ( definition.action ) {
+        case strategy_action::transfer: {
+            eosio::token::transfer_action transfer( "eosio.token"_n, { get_self(), "active"_n });
+            transfer.send( get_self(), definition.account, quantity, definition.memo );
+            break;
+        }
+        case strategy_action::donatetorex: {
+            eosiosystem::system_contract::donatetorex_action donatetorex( "eosio"_n, { get_self(), "active"_n });
+            donatetorex.send( get_self(), quantity, definition.memo );
+            break;
+        }
+        case strategy_action::buyramburn: {
+            eosiosystem::system_contract::buyramburn_action buyramburn( "eosio"_n, { get_self(), "active"_n });
+            buyramburn.send( get_self(), quantity, definition.memo );
+            break;
+        }
+        case strategy_action::recipients: {
+            check(false, "recipients strategy must be paid in batches");
+            break;
+        }
+    }
+}
+
+void reward::distribute_batch( epoch_row& epoch )
+{
+    eosio::token::transfer_action transfer( "eosio.token"_n, { get_self(), "active"_n });
+
+    uint32_t count = 0;
+    while ( epoch.in_progress() && count < DISTRIBUTE_BATCH_SIZE ) {
+        paged_strategy& paged = epoch.strategies.front();
+        const strategy_definition* definition = find_strategy( paged.strategy );
+        check(definition != nullptr, "strategy not defined");
+
+        // recipients are visited in account order, the cursor guarantees each is paid once per epoch
+        // (dust is skipped and remains for the next distribution)
+        recipients_table _recipients( get_self(), paged.strategy.value );
+        const bool completed = split::pay_batch( _recipients, epoch.cursor, count, DISTRIBUTE_BATCH_SIZE, paged.quantity.amount, paged.total_weight, [&]( const recipients_row& row, const int64_t amount ) {
+            const asset quantity{ amount, paged.quantity.symbol };
+            paged.paid += quantity;
+            transfer.send( get_self(), row.account, quantity, definition->memo );
+        });
+        if ( !completed ) break; // batch full
+
+        // strategy completed
+        update_paged_stats( paged );
+        epoch.strategies.erase( epoch.strategies.begin() );
+        epoch.cursor = 0;
+    }
+}
+
+// `next_distribution` is only moved forward once the distribution epoch completes
+void reward::set_next_distribution( config_row& config, const epoch_row& epoch )
+{
+    const bool throttle = !epoch.in_progress() && config.min_interval_sec > 0;
+    if ( config.in_progress == epoch.in_progress() && !throttle ) return;
+
+    config_table _config( get_self(), get_self().value );
+    config.in_progress = epoch.in_progress();
+    if ( throttle ) config.next_distribution = time_point_sec( current_time_point() ) + config.min_interval_sec;
+    _config.set( config, get_self() );
+}
+
+void reward::check_epoch_closed()
+{
+    config_table _config( get_self(), get_self().value );
+    check(!_config.get_or_default().in_progress, "distribution epoch in progress");
+}
+
+[[eosio::action]]
+void reward::migrate()
+{
+    require_auth( get_self() );
+
+    strategies_table _strategies( get_self(), get_self().value );
+    state_table _state( get_self(), get_self().value );
+
+    // rebuild from scratch (table rows are already sorted by strategy name)
+    state_row state;
+    for ( auto& row : _strategies ) {
+        state.total_weight += row.weight;
+        state.strategies.push_back({ row.strategy, row.weight });
+    }
+    _state.set( state, get_self() );
+}
+
+// weight of 0 removes the strategy from the cached state
+void reward::set_state_weight( const name strategy, const uint16_t weight )
+{
+    state_table _state( get_self(), get_self().value );
+    auto state = _state.get_or_default();
+
+    auto itr = lower_bound( state.strategies.begin(), state.strategies.end(), strategy, []( const strategy_weight& row, const name strategy ) {
+        return row.strategy < strategy;
+    });
+    if ( itr != state.strategies.end() && itr->strategy == strategy ) {
+        state.total_weight -= itr->weight;
+        if ( weight ) itr->weight = weight;
+        else state.strategies.erase(itr);
+    } else if ( weight ) {
+        state.strategies.insert(itr, { strategy, weight });
     }
+    state.total_weight += weight;
+    _state.set( state, get_self() );
 }
 
 } /// namespace eosio
@@ -5,14 +5,103 @@
 #include <eosio.token/eosio.token.hpp>
 #include <eosio.saving/eosio.saving.hpp>
 #include <eosio/singleton.hpp>
+#include <eosio.reward/split.hpp>
 
 using namespace std;
 
 namespace eosio {
 
-    const set<name> STRATEGIES = {
-        "eosio.rex"_n,
-        "eosio.bonds"_n,
+    struct strategy_amount {
+        name                strategy;
+        asset               quantity;
+    };
+
+    struct preview_result {
+        asset                       saving_balance;
+        asset                       balance;
+        uint32_t                    total_weight;
+        vector<strategy_amount>     strategies;
+        asset                       dust;
+        bool                        in_progress;
+    };
+
+    struct paged_strategy {
+        name                strategy;
+        asset               quantity;
+        uint64_t            total_weight;
+        asset               paid;
+    };
+
+    struct distribution_log {
+        time_point_sec      time;
+        asset               quantity;
+        asset               claimed;
+    };
+
+    // number of distributions kept in the `stats` ring buffer
+    static constexpr size_t STATS_HISTORY_SIZE = 16;
+
+    // maximum number of recipients paid per `distribute` call during a distribution epoch
+    static constexpr uint32_t DISTRIBUTE_BATCH_SIZE = 50;
+
+    /**
+     * Inline action used to pay out a strategy.
+     */
+    enum class strategy_action : uint8_t {
+        transfer,       // eosio.token::transfer to `account`
+        donatetorex,    // eosio::donatetorex (funds end up in `account`)
+        buyramburn,     // eosio::buyramburn (funds end up in `account`)
+        recipients,     // eosio.token::transfer to each row of `recipients` (pro rata, paged)
+    };
+
+    struct strategy_definition {
+        name                strategy;
+        name                account;    // empty for `recipients` (paid to each recipient)
+        strategy_action     action;
+        const char*         memo;
+    };
+
+    /**
+     * Strategies that can be configured using `setstrategy`.
+     *
+     * Must be kept sorted by strategy name, adding a strategy only requires a new row.
+     */
+    static constexpr strategy_definition STRATEGIES[] = {
+        { "eosio.bonds"_n,  "eosio.bonds"_n,    strategy_action::transfer,      "staking rewards" },
+        { "eosio.rex"_n,    "eosio.rex"_n,      strategy_action::donatetorex,   "staking rewards" },
+        { "recipients"_n,   name{},             strategy_action::recipients,    "rewards" },
+    };
+    static constexpr size_t STRATEGIES_SIZE = sizeof(STRATEGIES) / sizeof(STRATEGIES[0]);
+
+    constexpr bool strategies_sorted() {
+        for ( size_t i = 1; i < STRATEGIES_SIZE; ++i ) {
+            if ( !(STRATEGIES[i - 1].strategy < STRATEGIES[i].strategy) ) return false;
+        }
+        return true;
+    }
+    static_assert( strategies_sorted(), "STRATEGIES must be sorted by strategy name" );
+
+    /**
+     * Find a strategy definition by name.
+     *
+     * @param strategy - strategy name
+     * @return const strategy_definition* - definition or `nullptr` if strategy is not defined
+     */
+    constexpr const strategy_definition* find_strategy( const name strategy ) {
+        size_t lo = 0;
+        size_t hi = STRATEGIES_SIZE;
+        while ( lo < hi ) {
+            const size_t mid = (lo + hi) / 2;
+            if ( STRATEGIES[mid].strategy < strategy ) lo = mid + 1;
+            else hi = mid;
+        }
+        return lo < STRATEGIES_SIZE && STRATEGIES[lo].strategy == strategy ? &STRATEGIES[lo] : nullptr;
+    }
+    static_assert( find_strategy("eosio.rex"_n) != nullptr && find_strategy("foo"_n) == nullptr );
+
+    struct strategy_weight {
+        name                strategy;
+        uint16_t            weight;
     };
 
     /**
@@ -51,6 +140,198 @@ namespace eosio {
         };
         typedef eosio::multi_index< "strategies"_n, strategies_row > strategies_table;
 
+        /**
+         * ## TABLE `state`
+         *
+         * Cached copy of the `strategies` table, maintained by `setstrategy` and `delstrategy`
+         * so that `distribute` only needs a single read to plan the payout.
+         *
+         * - `{uint32_t} total_weight` - sum of all strategy weights
+         * - `{strategy_weight[]} strategies` - strategies and their weights (sorted by strategy name)
+         *
+         * ### example
+         *
+         * ```json
+         * {
+         *   "total_weight": 110,
+         *   "strategies": [
+         *     {"strategy": "eosio.bonds", "weight": 10},
+         *     {"strategy": "eosio.rex", "weight": 100}
+         *   ]
+         * }
+         * ```
+         */
+        struct [[eosio::table("state")]] state_row {
+            uint32_t                    total_weight = 0;
+            vector<strategy_weight>     strategies;
+        };
+        typedef eosio::singleton< "state"_n, state_row > state_table;
+
+        /**
+         * ## TABLE `stats`
+         *
+         * Distribution telemetry, updated in place by `distribute` (RAM usage does not grow over time).
+         *
+         * - `{strategy_amount[]} totals` - cumulative amount distributed per strategy (`recipients` credited with
+         *   the amount paid once its epoch completes)
+         * - `{uint64_t} distributions` - number of distributions
+         * - `{time_point_sec} last_distribution` - time of the last distribution
+         * - `{asset} last_quantity` - amount distributed in the last distribution
+         * - `{asset} total_claimed` - cumulative amount claimed from `eosio.saving`
+         * - `{asset} dust` - amount left behind by the last distribution (including the recipients rounding dust)
+         * - `{distribution_log[]} history` - ring buffer of the last distributions
+         * - `{uint16_t} history_index` - position of the next `history` entry to be overwritten
+         *
+         * ### example
+         *
+         * ```json
+         * {
+         *   "totals": [
+         *     {"strategy": "eosio.bonds", "quantity": "100.0000 EOS"},
+         *     {"strategy": "eosio.rex", "quantity": "1900.0000 EOS"}
+         *   ],
+         *   "distributions": 2,
+         *   "last_distribution": "2024-06-01T00:00:00",
+         *   "last_quantity": "1000.0000 EOS",
+         *   "total_claimed": "2000.0000 EOS",
+         *   "dust": "0.0000 EOS",
+         *   "history": [
+         *     {"time": "2024-05-31T00:00:00", "quantity": "1000.0000 EOS", "claimed": "1000.0000 EOS"},
+         *     {"time": "2024-06-01T00:00:00", "quantity": "1000.0000 EOS", "claimed": "1000.0000 EOS"}
+         *   ],
+         *   "history_index": 2
+         * }
+         * ```
+         */
+        struct [[eosio::table("stats")]] stats_row {
+            vector<strategy_amount>     totals;
+            uint64_t                    distributions = 0;
+            time_point_sec              last_distribution;
+            asset                       last_quantity;
+            asset                       total_claimed;
+            asset                       dust;
+            vector<distribution_log>    history;
+            uint16_t                    history_index = 0;
+        };
+        typedef eosio::singleton< "stats"_n, stats_row > stats_table;
+
+        /**
+         * ## TABLE `config`
+         *
+         * - `{name[]} sources` - accounts whose incoming EOS transfers are distributed on arrival
+         *   (`eosio.saving` only pays on `claim` and is handled by `distribute`)
+         * - `{uint32_t} min_interval_sec` - minimum interval between `distribute` calls (0 to disable)
+         * - `{asset} min_quantity` - minimum balance for `distribute` to proceed
+         * - `{asset} min_strategy_quantity` - strategy amounts below this are kept for the next distribution
+         * - `{time_point_sec} next_distribution` - earliest time of the next `distribute` call
+         * - `{bool} in_progress` - distribution epoch in progress (mirrors `epoch`, continuing it is not throttled)
+         *
+         * ### example
+         *
+         * ```json
+         * {
+         *   "sources": ["eosio.grants"],
+         *   "min_interval_sec": 3600,
+         *   "min_quantity": "100.0000 EOS",
+         *   "min_strategy_quantity": "1.0000 EOS",
+         *   "next_distribution": "2024-06-01T01:00:00",
+         *   "in_progress": false
+         * }
+         * ```
+         */
+        struct [[eosio::table("config")]] config_row {
+            vector<name>        sources;
+            uint32_t            min_interval_sec = 0;
+            asset               min_quantity = asset{0, TOKEN_SYMBOL};
+            asset               min_strategy_quantity = asset{0, TOKEN_SYMBOL};
+            time_point_sec      next_distribution;
+            bool                in_progress = false;
+        };
+        typedef eosio::singleton< "config"_n, config_row > config_table;
+
+        /**
+         * ## TABLE `recipients`
+         *
+         * Recipients of a `recipients` strategy (scope: strategy name).
+         *
+         * - `{name} account` - recipient account
+         * - `{uint16_t} weight` - recipient weight (proportional to the total weight of all recipients)
+         *
+         * ### example
+         *
+         * ```json
+         * [
+         *   {
+         *     "account": "alice",
+         *     "weight": 1
+         *   },
+         *   {
+         *     "account": "bob",
+         *     "weight": 3
+         *   }
+         * ]
+         * ```
+         */
+        struct [[eosio::table("recipients")]] recipients_row {
+            name                account;
+            uint16_t            weight;
+
+            uint64_t primary_key() const { return account.value; }
+        };
+        typedef eosio::multi_index< "recipients"_n, recipients_row > recipients_table;
+
+        /**
+         * ## TABLE `recipstate`
+         *
+         * Running total of the `recipients` weights (scope: strategy name), maintained by
+         * `setrecipient` and `delrecipient` so distributions never scan the recipients.
+         *
+         * - `{uint64_t} total_weight` - sum of all recipient weights (0 when no recipients)
+         *
+         * ### example
+         *
+         * ```json
+         * {
+         *   "total_weight": 4
+         * }
+         * ```
+         */
+        struct [[eosio::table("recipstate")]] recipients_state_row {
+            uint64_t            total_weight = 0;
+        };
+        typedef eosio::singleton< "recipstate"_n, recipients_state_row > recipients_state_table;
+
+        /**
+         * ## TABLE `epoch`
+         *
+         * Distribution epoch in progress, `recipients` strategies are paid in batches of
+         * `DISTRIBUTE_BATCH_SIZE` recipients per `distribute` call until the epoch completes.
+         *
+         * - `{uint64_t} epoch` - distribution epoch number
+         * - `{paged_strategy[]} strategies` - strategies left to pay (snapshot of amount and total recipient weight), first one in progress
+         * - `{uint64_t} cursor` - next recipient account (by value) of the strategy in progress
+         *
+         * ### example
+         *
+         * ```json
+         * {
+         *   "epoch": 1,
+         *   "strategies": [
+         *     {"strategy": "recipients", "quantity": "1000.0000 EOS", "total_weight": 4, "paid": "250.0000 EOS"}
+         *   ],
+         *   "cursor": "3773036822876127233"
+         * }
+         * ```
+         */
+        struct [[eosio::table("epoch")]] epoch_row {
+            uint64_t                    epoch = 0;
+            vector<paged_strategy>      strategies;
+            uint64_t                    cursor = 0;
+
+            bool in_progress() const { return !strategies.empty(); }
+        };
+        typedef eosio::singleton< "epoch"_n, epoch_row > epoch_table;
+
         /**
          * Set a strategy with a weight.
          *
@@ -68,16 +349,117 @@ namespace eosio {
         [[eosio::action]]
         void delstrategy( const name strategy );
 
+        /**
+         * Set a recipient of a `recipients` strategy with a weight.
+         *
+         * @param strategy - strategy name
+         * @param account - recipient account
+         * @param weight - recipient weight
+         */
+        [[eosio::action]]
+        void setrecipient( const name strategy, const name account, const uint16_t weight );
+
+        /**
+         * Delete a recipient of a `recipients` strategy.
+         *
+         * @param strategy - strategy name
+         * @param account - recipient account to delete
+         */
+        [[eosio::action]]
+        void delrecipient( const name strategy, const name account );
+
+        /**
+         * Set the accounts whose incoming transfers are distributed on arrival.
+         *
+         * @param sources - source accounts
+         */
+        [[eosio::action]]
+        void setsources( const vector<name> sources );
+
+        /**
+         * Set the throttles of the permissionless `distribute` action.
+         *
+         * @param min_interval_sec - minimum interval between `distribute` calls (0 to disable)
+         * @param min_quantity - minimum balance for `distribute` to proceed
+         * @param min_strategy_quantity - strategy amounts below this are kept for the next distribution
+         *
+         * @post `next_distribution` is reset, new interval applies from the next distribution
+         */
+        [[eosio::action]]
+        void setthrottle( const uint32_t min_interval_sec, const asset min_quantity, const asset min_strategy_quantity );
+
         /**
          * Distribute rewards to all defined strategies.
+         *
+         * Claims pending `eosio.saving` rewards and distributes them together with the liquid balance.
+         *
+         * Opens a distribution epoch when `recipients` strategies are configured, while an epoch
+         * is in progress each call pays the next batch of recipients.
          */
         [[eosio::action]]
         void distribute();
 
+        /**
+         * Abort the distribution epoch in progress.
+         *
+         * Way out of an epoch that cannot complete (ex: a recipient rejecting transfers), the unpaid
+         * amounts stay in the liquid balance and are swept by the next `distribute`.
+         *
+         * @post strategies and recipients can be modified again
+         */
+        [[eosio::action]]
+        void abortepoch();
+
+        /**
+         * Distribute EOS transfers received from `sources` to all defined strategies.
+         */
+        [[eosio::on_notify("eosio.token::transfer")]]
+        void on_transfer( const name from, const name to, const asset quantity, const string memo );
+
+        /**
+         * Preview the next distribution without sending a transaction.
+         *
+         * @return preview_result - pending `eosio.saving` balance, liquid token balance, total weight,
+         *   amounts `distribute` would send to each strategy (0 when skipped as dust), the remaining dust
+         *   and whether a distribution epoch is in progress (next `distribute` only pays recipients,
+         *   `strategies` is empty and `dust` is 0)
+         *
+         * ### example
+         *
+         * ```json
+         * {
+         *   "saving_balance": "1000.0000 EOS",
+         *   "balance": "0.0001 EOS",
+         *   "total_weight": 110,
+         *   "strategies": [
+         *     {"strategy": "eosio.bonds", "quantity": "90.9091 EOS"},
+         *     {"strategy": "eosio.rex", "quantity": "909.0910 EOS"}
+         *   ],
+         *   "dust": "0.0000 EOS",
+         *   "in_progress": false
+         * }
+         * ```
+         */
+        [[eosio::action, eosio::read_only]]
+        preview_result preview();
+
+        /**
+         * Build the `state` singleton from the existing `strategies` table rows.
+         */
+        [[eosio::action]]
+        void migrate();
+
         // ACTION WRAPPERS
         using distribute_action = eosio::action_wrapper<"distribute"_n, &reward::distribute>;
+        using abortepoch_action = eosio::action_wrapper<"abortepoch"_n, &reward::abortepoch>;
         using setstrategy_action = eosio::action_wrapper<"setstrategy"_n, &reward::setstrategy>;
         using delstrategy_action = eosio::action_wrapper<"delstrategy"_n, &reward::delstrategy>;
+        using setsources_action = eosio::action_wrapper<"setsources"_n, &reward::setsources>;
+        using setthrottle_action = eosio::action_wrapper<"setthrottle"_n, &reward::setthrottle>;
+        using setrecipient_action = eosio::action_wrapper<"setrecipient"_n, &reward::setrecipient>;
+        using delrecipient_action = eosio::action_wrapper<"delrecipient"_n, &reward::delrecipient>;
+        using migrate_action = eosio::action_wrapper<"migrate"_n, &reward::migrate>;
+        using preview_action = eosio::action_wrapper<"preview"_n, &reward::preview>;
 
         /**
          * Get the total weight of all strategies.
@@ -86,12 +468,21 @@ namespace eosio {
          * @return uint16_t - total weight
          */
         static uint32_t get_total_weight( const name contract = "eosio.reward"_n ) {
-            strategies_table _strategies( contract, contract.value );
-            uint32_t total_weight = 0;
-            for (auto& row : _strategies) {
-                total_weight += row.weight;
-            }
-            return total_weight;
+            state_table _state( contract, contract.value );
+            return _state.get_or_default().total_weight;
         }
+
+    private:
+        preview_result get_preview( const config_row& config, const epoch_row& epoch );
+        vector<strategy_amount> get_strategy_amounts( const state_row& state, const asset quantity, const asset min_quantity );
+        void distribute_result( epoch_row& epoch, const preview_result& result );
+        void set_next_distribution( config_row& config, const epoch_row& epoch );
+        void update_stats( const preview_result& result );
+        void update_paged_stats( const paged_strategy& paged );
+        void add_stats_total( stats_row& stats, const strategy_amount& amount );
+        void set_state_weight( const name strategy, const uint16_t weight );
+        void send_strategy( const strategy_definition& definition, const asset quantity );
+        void distribute_batch( epoch_row& epoch );
+        void check_epoch_closed();
     };
 } /// namespace eosio
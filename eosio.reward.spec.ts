@@ -1,4 +1,4 @@
-import { Asset, Name } from '@wharfkit/antelope'
+import { Asset, Name, Serializer } from '@wharfkit/antelope'
 import { describe, expect, test } from 'bun:test'
 import { Blockchain, expectToThrow } from '@eosnetwork/vert'
 
@@ -6,7 +6,12 @@ const blockchain = new Blockchain()
 const rex = 'eosio.rex'
 const bonds = 'eosio.bonds'
 const saving = 'eosio.saving'
-blockchain.createAccounts(rex, bonds, "eosio")
+blockchain.createAccounts(rex, bonds, "eosio", "alice", "bob")
+
+// more recipients than `DISTRIBUTE_BATCH_SIZE` (50) to test distribution epochs
+const letters = 'abcdefghijklmnopqrstuvwxyz'
+const recipients = Array.from({length: 60}, (_, i) => `recip${letters[Math.floor(i / 26)]}${letters[i % 26]}`)
+blockchain.createAccounts(...recipients)
 
 const reward_contract = 'eosio.reward'
 const contracts = {
@@ -37,6 +42,48 @@ function getStrategies() {
     return row;
 }
 
+function getState() {
+    const scope = Name.from(reward_contract).value.value
+    return contracts.reward.tables
+        .state(scope)
+        .getTableRows()[0]
+}
+
+function getStats() {
+    const scope = Name.from(reward_contract).value.value
+    return contracts.reward.tables
+        .stats(scope)
+        .getTableRows()[0]
+}
+
+function getConfig() {
+    const scope = Name.from(reward_contract).value.value
+    return contracts.reward.tables
+        .config(scope)
+        .getTableRows()[0]
+}
+
+function getEpoch() {
+    const scope = Name.from(reward_contract).value.value
+    return contracts.reward.tables
+        .epoch(scope)
+        .getTableRows()[0]
+}
+
+function getRecipientsWeight(strategy: string) {
+    const scope = Name.from(strategy).value.value
+    return contracts.reward.tables
+        .recipstate(scope)
+        .getTableRows()[0]?.total_weight
+}
+
+// decode the `preview_result` returned by the read-only `preview` action
+async function getPreview() {
+    await contracts.reward.actions.preview([]).send();
+    const trace = blockchain.actionTraces.find((trace: any) => trace.action.toString() === 'preview')
+    return Serializer.objectify(Serializer.decode({ data: trace.returnValue, type: 'preview_result', abi: contracts.reward.abi }))
+}
+
 function getBalances(){
     const get = (account:string) => ({
         balance: getTokenBalance(account, 'EOS')
@@ -46,6 +93,8 @@ function getBalances(){
         rex: get(rex),
         saving: get(saving),
         bonds: get(bonds),
+        alice: get('alice'),
+        bob: get('bob'),
     }
 }
 
@@ -94,6 +143,60 @@ describe(reward_contract, () => {
         expect(after.reward.balance - before.reward.balance).toBe(0)
     });
 
+    test("eosio.reward::stats", async () => {
+        const stats = getStats()
+        expect(stats.distributions).toBe(2)
+        expect(stats.totals).toEqual([
+            {strategy: 'eosio.bonds', quantity: '100.0000 EOS'},
+            {strategy: 'eosio.rex', quantity: '1900.0000 EOS'},
+        ])
+        expect(stats.last_quantity).toBe('1000.0000 EOS')
+        expect(stats.total_claimed).toBe('2000.0000 EOS')
+        expect(stats.dust).toBe('0.0000 EOS')
+        expect(stats.history.length).toBe(2)
+        expect(stats.history_index).toBe(2)
+    });
+
+    test("eosio.reward::state", async () => {
+        expect(getState()).toEqual({
+            total_weight: 100,
+            strategies: [
+                {strategy: 'eosio.bonds', weight: 10},
+                {strategy: 'eosio.rex', weight: 90},
+            ],
+        })
+        await contracts.reward.actions.migrate([]).send();
+        expect(getState().total_weight).toBe(100)
+    });
+
+    test('eosio.reward::preview - matches next distribution', async () => {
+        await contracts.token.actions.transfer(['eosio', reward_contract, '100.0000 EOS', '']).send();
+        await contracts.token.actions.transfer(['eosio', "eosio.saving", '1000.0000 EOS', '']).send();
+        const before = getBalances();
+        const preview = await getPreview();
+
+        // read-only
+        expect(getBalances()).toEqual(before)
+        expect(preview).toEqual({
+            saving_balance: '1000.0000 EOS',
+            balance: '100.0000 EOS',
+            total_weight: 100,
+            strategies: [
+                {strategy: 'eosio.bonds', quantity: '110.0000 EOS'},
+                {strategy: 'eosio.rex', quantity: '990.0000 EOS'},
+            ],
+            dust: '0.0000 EOS',
+            in_progress: false,
+        })
+
+        await contracts.reward.actions.distribute([]).send();
+        const after = getBalances();
+        expect(after.bonds.balance - before.bonds.balance).toBe(Asset.from(preview.strategies[0].quantity).units.toNumber())
+        expect(after.rex.balance - before.rex.balance).toBe(Asset.from(preview.strategies[1].quantity).units.toNumber())
+        expect(after.reward.balance).toBe(Asset.from(preview.dust).units.toNumber())
+        expect(getStats().dust).toBe(preview.dust)
+    })
+
     test('eosio.reward::distibute::error - no balance to distribute', async () => {
         const action = contracts.reward.actions.distribute([]).send();
         await expectToThrow(action, 'eosio_assert: no balance to distribute')
@@ -113,4 +216,224 @@ describe(reward_contract, () => {
         const action = contracts.reward.actions.setstrategy(["eosio.rex", 0]).send();
         await expectToThrow(action, 'eosio_assert: weight must be greater than 0')
     })
-})
\ No newline at end of file
+
+    test('eosio.reward::setrecipient::error - strategy does not accept recipients', async () => {
+        const action = contracts.reward.actions.setrecipient(["eosio.rex", "alice", 1]).send();
+        await expectToThrow(action, 'eosio_assert: strategy does not accept recipients')
+    })
+
+    test("eosio.reward::distibute - recipients 25/75% to alice/bob", async () => {
+        await contracts.reward.actions.setrecipient(['recipients', 'alice', 1]).send();
+        await contracts.reward.actions.setrecipient(['recipients', 'bob', 3]).send();
+        await contracts.reward.actions.delstrategy(['eosio.bonds']).send();
+        await contracts.reward.actions.delstrategy(['eosio.rex']).send();
+        await contracts.reward.actions.setstrategy(['recipients', 100]).send();
+        await contracts.token.actions.transfer(['eosio', "eosio.saving", '1000.0000 EOS', '']).send();
+        const before = getBalances();
+        await contracts.reward.actions.distribute([]).send();
+        const after = getBalances();
+
+        expect(after.alice.balance - before.alice.balance).toBe(2500000)
+        expect(after.bob.balance - before.bob.balance).toBe(7500000)
+        expect(after.reward.balance - before.reward.balance).toBe(0)
+        expect(getRecipientsWeight('recipients')).toBe(4)
+        expect(getStats().totals).toContainEqual({strategy: 'recipients', quantity: '1000.0000 EOS'})
+    });
+
+    test("eosio.reward::on_transfer - transfers from sources are distributed on arrival", async () => {
+        await contracts.reward.actions.setsources([["eosio"]]).send();
+        const before = getBalances();
+        await contracts.token.actions.transfer(['eosio', reward_contract, '100.0000 EOS', '']).send();
+        const after = getBalances();
+
+        expect(after.alice.balance - before.alice.balance).toBe(250000)
+        expect(after.bob.balance - before.bob.balance).toBe(750000)
+        expect(after.reward.balance - before.reward.balance).toBe(0)
+    });
+
+    test("eosio.reward::on_transfer - other transfers are swept by distribute", async () => {
+        await contracts.reward.actions.setsources([[]]).send();
+        await contracts.token.actions.transfer(['eosio', reward_contract, '100.0000 EOS', '']).send();
+        expect(getBalances().reward.balance).toBe(1000000)
+
+        await contracts.reward.actions.distribute([]).send();
+        expect(getBalances().reward.balance).toBe(0)
+    });
+
+    test("eosio.reward::distibute - claim and liquid balance are distributed once", async () => {
+        await contracts.token.actions.transfer(['eosio', reward_contract, '100.0000 EOS', '']).send();
+        await contracts.token.actions.transfer(['eosio', "eosio.saving", '1000.0000 EOS', '']).send();
+        const distributions = getStats().distributions
+        const before = getBalances();
+        await contracts.reward.actions.distribute([]).send();
+        const after = getBalances();
+
+        expect(after.alice.balance - before.alice.balance).toBe(2750000)
+        expect(after.bob.balance - before.bob.balance).toBe(8250000)
+        expect(after.reward.balance - before.reward.balance).toBe(0)
+        expect(getStats().distributions).toBe(distributions + 1)
+        expect(getStats().last_quantity).toBe('1100.0000 EOS')
+    });
+
+    test('eosio.reward::setsources::error - eosio.saving rewards are claimed by `distribute`', async () => {
+        const action = contracts.reward.actions.setsources([["eosio.saving"]]).send();
+        await expectToThrow(action, 'eosio_assert: eosio.saving rewards are claimed by `distribute`')
+    })
+
+    test('eosio.reward::distibute::error - balance below minimum distribution', async () => {
+        await contracts.reward.actions.setthrottle([0, '1000.0000 EOS', '0.0000 EOS']).send();
+        await contracts.token.actions.transfer(['eosio', reward_contract, '100.0000 EOS', '']).send();
+        const action = contracts.reward.actions.distribute([]).send();
+        await expectToThrow(action, 'eosio_assert: balance below minimum distribution')
+    })
+
+    test('eosio.reward::distibute::error - no strategy amount to distribute', async () => {
+        await contracts.reward.actions.setthrottle([0, '0.0000 EOS', '1000.0000 EOS']).send();
+        const stats = getStats()
+        const action = contracts.reward.actions.distribute([]).send();
+        await expectToThrow(action, 'eosio_assert: no strategy amount to distribute')
+        expect(getStats()).toEqual(stats)
+    })
+
+    test('eosio.reward::distibute::error - distribution throttled', async () => {
+        await contracts.reward.actions.setthrottle([3600, '0.0000 EOS', '0.0000 EOS']).send();
+        await contracts.reward.actions.distribute([]).send();
+        expect(getBalances().reward.balance).toBe(0)
+
+        await contracts.token.actions.transfer(['eosio', reward_contract, '100.0000 EOS', '']).send();
+        const action = contracts.reward.actions.distribute([]).send();
+        await expectToThrow(action, 'eosio_assert: distribution throttled')
+    })
+
+    test('eosio.reward::setthrottle::error - invalid min_quantity', async () => {
+        const action = contracts.reward.actions.setthrottle([0, '-1.0000 EOS', '0.0000 EOS']).send();
+        await expectToThrow(action, 'eosio_assert: invalid min_quantity')
+    })
+
+    test("eosio.reward::setrecipient - running total weight", async () => {
+        await contracts.reward.actions.setthrottle([0, '0.0000 EOS', '0.0000 EOS']).send();
+        for (const account of recipients) {
+            await contracts.reward.actions.setrecipient(['recipients', account, 1]).send();
+        }
+        await contracts.reward.actions.setrecipient(['recipients', 'bob', 2]).send();
+        await contracts.reward.actions.setrecipient(['recipients', 'bob', 3]).send();
+        expect(getRecipientsWeight('recipients')).toBe(64)
+    });
+
+    test("eosio.reward::distibute - opens epoch and pays first batch", async () => {
+        // 100 EOS left by the throttle test, 1.5625 EOS per unit of weight
+        expect(getBalances().reward.balance).toBe(1000000)
+        await contracts.reward.actions.distribute([]).send();
+
+        const epoch = getEpoch()
+        expect(epoch.strategies.length).toBe(1)
+        expect(epoch.strategies[0].total_weight).toBe(64)
+        // alice, bob and 48 recipients (52 units of weight)
+        expect(epoch.strategies[0].paid).toBe('81.2500 EOS')
+        expect(getTokenBalance(recipients[47], 'EOS')).toBe(15625)
+        expect(getTokenBalance(recipients[48], 'EOS')).toBe(0)
+
+        // next `distribute` only pays recipients, nothing is split
+        const preview = await getPreview()
+        expect(preview.in_progress).toBe(true)
+        expect(preview.balance).toBe('18.7500 EOS')
+        expect(preview.strategies).toEqual([])
+        expect(preview.dust).toBe('0.0000 EOS')
+    });
+
+    test('eosio.reward::setstrategy::error - distribution epoch in progress', async () => {
+        const action = contracts.reward.actions.setstrategy(['recipients', 50]).send();
+        await expectToThrow(action, 'eosio_assert: distribution epoch in progress')
+    })
+
+    test('eosio.reward::setrecipient::error - distribution epoch in progress', async () => {
+        const action = contracts.reward.actions.setrecipient(['recipients', 'alice', 2]).send();
+        await expectToThrow(action, 'eosio_assert: distribution epoch in progress')
+    })
+
+    test('eosio.reward::delrecipient::error - distribution epoch in progress', async () => {
+        const action = contracts.reward.actions.delrecipient(['recipients', 'alice']).send();
+        await expectToThrow(action, 'eosio_assert: distribution epoch in progress')
+    })
+
+    test("eosio.reward::distibute - continues epoch until completed", async () => {
+        const distributions = getStats().distributions
+        await contracts.reward.actions.distribute([]).send();
+
+        expect(getEpoch().strategies.length).toBe(0)
+        expect(getTokenBalance(recipients[48], 'EOS')).toBe(15625)
+        expect(getTokenBalance(recipients[59], 'EOS')).toBe(15625)
+        expect(getBalances().reward.balance).toBe(0)
+        // continuation only pays recipients
+        expect(getStats().distributions).toBe(distributions)
+
+        await contracts.reward.actions.delrecipient(['recipients', recipients[0]]).send();
+        expect(getRecipientsWeight('recipients')).toBe(63)
+    });
+
+    test("eosio.reward::distibute - continuing an epoch is not throttled", async () => {
+        await contracts.reward.actions.setthrottle([3600, '0.0000 EOS', '0.0000 EOS']).send();
+        await contracts.token.actions.transfer(['eosio', reward_contract, '63.0000 EOS', '']).send();
+        await contracts.reward.actions.distribute([]).send();
+        await contracts.reward.actions.distribute([]).send(); // completes epoch and throttles
+        expect(getEpoch().strategies.length).toBe(0)
+
+        // transfers from sources open an epoch on arrival
+        await contracts.reward.actions.setsources([["eosio"]]).send();
+        await contracts.token.actions.transfer(['eosio', reward_contract, '63.0000 EOS', '']).send();
+        expect(getEpoch().strategies.length).toBe(1)
+        expect(getConfig().in_progress).toBe(true)
+
+        await contracts.reward.actions.distribute([]).send();
+        expect(getEpoch().strategies.length).toBe(0)
+        expect(getConfig().in_progress).toBe(false)
+        expect(getBalances().reward.balance).toBe(0)
+
+        const action = contracts.reward.actions.distribute([]).send();
+        await expectToThrow(action, 'eosio_assert: distribution throttled')
+    })
+
+    test("eosio.reward::on_transfer - amounts below minimum are not recorded", async () => {
+        await contracts.reward.actions.setthrottle([0, '0.0000 EOS', '1.0000 EOS']).send();
+        const stats = getStats()
+        await contracts.token.actions.transfer(['eosio', reward_contract, '0.1000 EOS', '']).send();
+
+        expect(getBalances().reward.balance).toBe(1000)
+        expect(getEpoch().strategies.length).toBe(0)
+        expect(getStats()).toEqual(stats)
+    })
+
+    test("eosio.reward::abortepoch - unpaid amounts are swept by the next distribution", async () => {
+        await contracts.reward.actions.setsources([[]]).send();
+        await contracts.reward.actions.setthrottle([0, '0.0000 EOS', '0.0000 EOS']).send();
+        // 63.0000 EOS with the 0.1000 EOS left by the previous test
+        await contracts.token.actions.transfer(['eosio', reward_contract, '62.9000 EOS', '']).send();
+        await contracts.reward.actions.distribute([]).send();
+        expect(getConfig().in_progress).toBe(true)
+        // alice, bob and 48 recipients paid (52 units of weight)
+        expect(getBalances().reward.balance).toBe(110000)
+
+        const recipients_total = () => getStats().totals.find((row: any) => row.strategy === 'recipients').quantity
+        const total = recipients_total()
+        await contracts.reward.actions.abortepoch([]).send();
+        expect(getEpoch().strategies.length).toBe(0)
+        expect(getConfig().in_progress).toBe(false)
+        expect(getBalances().reward.balance).toBe(110000)
+
+        // only the amount paid is credited, unpaid amount is kept as dust
+        expect(Asset.from(recipients_total()).units.toNumber() - Asset.from(total).units.toNumber()).toBe(520000)
+        expect(getStats().dust).toBe('11.0000 EOS')
+
+        // recipients can be modified again
+        await contracts.reward.actions.delrecipient(['recipients', recipients[59]]).send();
+        await contracts.reward.actions.distribute([]).send();
+        expect(getEpoch().strategies[0].quantity).toBe('11.0000 EOS')
+        expect(getEpoch().strategies[0].total_weight).toBe(62)
+        await contracts.reward.actions.abortepoch([]).send();
+    })
+
+    test('eosio.reward::abortepoch::error - no distribution epoch in progress', async () => {
+        const action = contracts.reward.actions.abortepoch([]).send();
+        await expectToThrow(action, 'eosio_assert: no distribution epoch in progress')
+    })
+})
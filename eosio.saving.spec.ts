@@ -0,0 +1,136 @@
+import { Asset, Name } from '@wharfkit/antelope'
+import { describe, expect, test } from 'bun:test'
+import { Blockchain, expectToThrow } from '@eosnetwork/vert'
+
+// `eosio.saving` is built from external/eosio.saving by `./build.sh`,
+// `eosio.saving.v1` is the previous release (claimers rows without `index`) used to test upgrades.
+const saving = 'eosio.saving'
+const grants = 'grants'
+const labs = 'labs'
+
+function setup(saving_wasm: string) {
+    const blockchain = new Blockchain()
+    blockchain.createAccounts('eosio', grants, labs)
+    const contracts = {
+        token: blockchain.createContract('eosio.token', 'external/eosio.token/eosio.token', true),
+        saving: blockchain.createContract(saving, saving_wasm, true),
+    }
+    return { blockchain, contracts }
+}
+
+async function issue({ contracts }: ReturnType<typeof setup>) {
+    const supply = `2100000000.0000 EOS`
+    await contracts.token.actions.create(['eosio.token', supply]).send()
+    await contracts.token.actions.issue(['eosio.token', supply, '']).send()
+    await contracts.token.actions.transfer(['eosio.token', 'eosio', '350000000.0000 EOS', '']).send()
+}
+
+function getTokenBalance({ contracts }: ReturnType<typeof setup>, account: string) {
+    const scope = Name.from(account).value.value
+    const primary_key = Asset.SymbolCode.from('EOS').value.value
+    const row = contracts.token.tables
+        .accounts(scope)
+        .getTableRow(primary_key)
+    if (!row) return 0;
+    return Asset.from(row.balance).units.toNumber()
+}
+
+function getClaimer({ contracts }: ReturnType<typeof setup>, account: string) {
+    const scope = Name.from(saving).value.value
+    return contracts.saving.tables
+        .claimers(scope)
+        .getTableRow(Name.from(account).value.value)
+}
+
+function getConfig({ contracts }: ReturnType<typeof setup>) {
+    const scope = Name.from(saving).value.value
+    return contracts.saving.tables
+        .config(scope)
+        .getTableRows()[0]
+}
+
+describe(saving, () => {
+    const chain = setup('external/eosio.saving/eosio.saving')
+    const { contracts } = chain
+
+    test('eosio.token::issue::EOS', async () => {
+        await issue(chain)
+    })
+
+    test('eosio.saving::setdistrib - creates claimers', async () => {
+        await contracts.saving.actions.setdistrib([[{account: grants, percent: 2500}, {account: labs, percent: 7500}]]).send()
+
+        expect(getClaimer(chain, grants)).toEqual({account: grants, balance: '0.0000 EOS', index: 0})
+        expect(getClaimer(chain, labs)).toEqual({account: labs, balance: '0.0000 EOS', index: 0})
+    })
+
+    test('eosio.saving::on_transfer - only updates index', async () => {
+        await contracts.token.actions.transfer(['eosio', saving, '100.0000 EOS', '']).send()
+
+        expect(getConfig(chain).index).toBe(1000000)
+        expect(getClaimer(chain, grants)).toEqual({account: grants, balance: '0.0000 EOS', index: 0})
+        expect(getClaimer(chain, labs)).toEqual({account: labs, balance: '0.0000 EOS', index: 0})
+    })
+
+    test('eosio.saving::claim - pays share and zeroes row', async () => {
+        const before = getTokenBalance(chain, grants)
+        await contracts.saving.actions.claim([grants]).send(`${grants}@active`)
+
+        expect(getTokenBalance(chain, grants) - before).toBe(250000)
+        expect(getClaimer(chain, grants)).toEqual({account: grants, balance: '0.0000 EOS', index: 1000000})
+    })
+
+    test('eosio.saving::setdistrib - settles pending balances', async () => {
+        await contracts.saving.actions.setdistrib([[{account: grants, percent: 10000}]]).send()
+
+        expect(getClaimer(chain, grants)).toEqual({account: grants, balance: '0.0000 EOS', index: 1000000})
+        expect(getClaimer(chain, labs)).toEqual({account: labs, balance: '75.0000 EOS', index: 1000000})
+
+        await contracts.token.actions.transfer(['eosio', saving, '100.0000 EOS', '']).send()
+        const before = { grants: getTokenBalance(chain, grants), labs: getTokenBalance(chain, labs) }
+        await contracts.saving.actions.claim([grants]).send(`${grants}@active`)
+        await contracts.saving.actions.claim([labs]).send(`${labs}@active`)
+
+        expect(getTokenBalance(chain, grants) - before.grants).toBe(1000000)
+        expect(getTokenBalance(chain, labs) - before.labs).toBe(750000)
+    })
+
+    test('eosio.saving::claim::error - Distribution account does not exists', async () => {
+        const action = contracts.saving.actions.claim(['eosio']).send('eosio@active')
+        await expectToThrow(action, 'eosio_assert: Distribution account does not exists')
+    })
+})
+
+describe(`${saving}::upgrade`, () => {
+    const chain = setup('external/eosio.saving/eosio.saving.v1')
+    const { contracts } = chain
+
+    test('eosio.saving.v1 - rows without index', async () => {
+        await issue(chain)
+        await contracts.saving.actions.setdistrib([[{account: grants, percent: 5000}, {account: labs, percent: 5000}]]).send()
+        await contracts.token.actions.transfer(['eosio', saving, '100.0000 EOS', '']).send()
+        await contracts.saving.actions.claim([labs]).send(`${labs}@active`)
+
+        // v1 erases the claimer row on claim
+        expect(getClaimer(chain, grants)).toEqual({account: grants, balance: '50.0000 EOS'})
+        expect(getClaimer(chain, labs)).toBeUndefined()
+    })
+
+    test('eosio.saving - reads v1 rows after upgrade', async () => {
+        // redeploy the current contract on the same account, table rows are kept
+        const upgraded = {
+            ...chain,
+            contracts: { ...contracts, saving: chain.blockchain.createContract(saving, 'external/eosio.saving/eosio.saving', true) },
+        }
+        await contracts.token.actions.transfer(['eosio', saving, '100.0000 EOS', '']).send()
+
+        const before = { grants: getTokenBalance(upgraded, grants), labs: getTokenBalance(upgraded, labs) }
+        await upgraded.contracts.saving.actions.claim([grants]).send(`${grants}@active`)
+        await upgraded.contracts.saving.actions.claim([labs]).send(`${labs}@active`)
+
+        expect(getTokenBalance(upgraded, grants) - before.grants).toBe(1000000)
+        expect(getTokenBalance(upgraded, labs) - before.labs).toBe(500000)
+        expect(getClaimer(upgraded, grants)).toEqual({account: grants, balance: '0.0000 EOS', index: 1000000})
+        expect(getClaimer(upgraded, labs)).toEqual({account: labs, balance: '0.0000 EOS', index: 1000000})
+    })
+})
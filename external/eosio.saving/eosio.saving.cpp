@@ -17,6 +17,39 @@ void saving::setdistrib( const std::vector<distribute_account>& accounts ) {
         }
         check(remaining_percent == 0, "Total percentage does not equal 100%");
     }
+    // settle pending balances before percentages change
+    claimers_table _claimers{ get_self(), get_self().value };
+    const uint64_t index = config.index.value_or(0);
+    for ( auto itr = _claimers.begin(); itr != _claimers.end(); ++itr ) {
+        const asset balance = get_pending_balance( *itr, config );
+        if ( itr->balance == balance && itr->index.has_value() && itr->index.value() == index ) continue;
+        _claimers.modify(itr, get_self(), [&]( auto& row ) {
+            row.balance = balance;
+            row.index.emplace( index );
+        });
+    }
+
+    // create claimers so incoming transfers never need to touch the table
+    // (configured accounts without a row have accrued since index 0, settle them as well)
+    for ( const distribute_account dist_row : config.accounts ) {
+        if ( dist_row.account == get_self() ) continue;
+        if ( _claimers.find(dist_row.account.value) != _claimers.end() ) continue;
+        _claimers.emplace(get_self(), [&]( auto& row ) {
+            row.account = dist_row.account;
+            row.balance = get_pending_balance( claimers_row{ dist_row.account, asset{0, TOKEN_SYMBOL} }, config );
+            row.index.emplace( index );
+        });
+    }
+    for ( const distribute_account dist_row : accounts ) {
+        if ( dist_row.account == get_self() ) continue;
+        if ( _claimers.find(dist_row.account.value) != _claimers.end() ) continue;
+        _claimers.emplace(get_self(), [&]( auto& row ) {
+            row.account = dist_row.account;
+            row.balance = asset{0, TOKEN_SYMBOL};
+            row.index.emplace( index );
+        });
+    }
+
     // set accounts
     config.accounts = accounts;
     _config.set( config, get_self() );
@@ -25,21 +58,40 @@ void saving::setdistrib( const std::vector<distribute_account>& accounts ) {
 [[eosio::action]]
 void saving::claim(const name& claimer) {
     require_auth( claimer );
+    config_table _config{ get_self(), get_self().value };
     claimers_table _claimers{ get_self(), get_self().value };
+    const auto config = _config.get_or_default();
+    const uint64_t index = config.index.value_or(0);
+
+    // accounts configured before `index` was introduced may not have a row yet
+    auto itr = _claimers.find(claimer.value);
+    check(itr != _claimers.end() || get_percent( config, claimer ) > 0, "Distribution account does not exists");
 
-    auto& itr = _claimers.get(claimer.value, "Distribution account does not exists");
-    if (itr.balance.amount != 0) {
+    const asset balance = itr != _claimers.end() ? get_pending_balance( *itr, config ) : get_pending_balance( claimers_row{ claimer, asset{0, TOKEN_SYMBOL} }, config );
+    if (balance.amount != 0) {
         eosio::token::transfer_action transfer{ TOKEN_CONTRACT, { get_self(), "active"_n } };
-        transfer.send( get_self(), claimer, itr.balance, get_self().to_string() + " distribution claim" );
+        transfer.send( get_self(), claimer, balance, get_self().to_string() + " distribution claim" );
+    }
+
+    // keep row to avoid RAM churn on the next distribution
+    if ( itr == _claimers.end() ) {
+        _claimers.emplace(get_self(), [&]( auto& row ) {
+            row.account = claimer;
+            row.balance = asset{0, TOKEN_SYMBOL};
+            row.index.emplace( index );
+        });
+    } else {
+        _claimers.modify(itr, get_self(), [&]( auto& row ) {
+            row.balance = asset{0, TOKEN_SYMBOL};
+            row.index.emplace( index );
+        });
     }
-    _claimers.erase(itr);
 }
 
 [[eosio::on_notify("*::transfer")]]
 void saving::on_transfer( const name& from, const name& to, const asset& quantity, const string& memo ) {
     // tables
     config_table _config{ get_self(), get_self().value };
-    claimers_table _claimers{ get_self(), get_self().value };
 
     // ignore transfer not directed to contract
     if (to != get_self()) return;
@@ -52,40 +104,12 @@ void saving::on_transfer( const name& from, const name& to, const asset& quantit
     // ignore no-initialized contracts
     if ( !_config.exists() ) return;
 
-    // distribute accounts
-    const auto accounts = _config.get().accounts;
+    auto config = _config.get();
 
     // ignore no distributions accounts
-    if ( accounts.size() == 0 ) return;
-
-    asset remaining = quantity;
-    for ( const distribute_account dist_row : accounts ) {
-        if ( remaining.amount == 0 ) break;
-        asset dist_amount = quantity * dist_row.percent / MAX_DISTRIBUTE_PERCENT;
-
-        // handle distributing dust from last account
-        if ( remaining < dist_amount ) dist_amount = remaining;
-        remaining -= dist_amount;
-
-        // do not update claimer balance if self (eosio.saving)
-        if ( dist_row.account == get_self() ) continue;
-
-        // ignore dust (0.0000 EOS) no need to create/update table
-        if ( dist_amount.amount <= 0 ) continue;
+    if ( config.accounts.size() == 0 ) return;
 
-        // add to table
-        auto itr = _claimers.find(dist_row.account.value);
-        if (itr == _claimers.end()) {
-            // create initial balance
-            _claimers.emplace(get_self(), [&]( auto& row) {
-                row.account = dist_row.account;
-                row.balance = dist_amount;
-            });
-        } else {
-            // update existing balance
-            _claimers.modify(itr, get_self(), [&]( auto& row ){
-                row.balance += dist_amount;
-            });
-        }
-    }
-}
\ No newline at end of file
+    // claimer shares are computed lazily from the index (see `get_pending_balance`)
+    config.index.emplace( config.index.value_or(0) + quantity.amount );
+    _config.set( config, get_self() );
+}
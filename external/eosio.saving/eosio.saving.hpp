@@ -3,12 +3,16 @@
 #include <eosio/eosio.hpp>
 #include <eosio/asset.hpp>
 #include <eosio/singleton.hpp>
+#include <eosio/binary_extension.hpp>
 
 #include <string>
 
+#include "eosio.saving.split.hpp"
+
 using namespace eosio;
 
 static constexpr int64_t MAX_DISTRIBUTE_PERCENT = 100'00; // 100%
+static_assert( MAX_DISTRIBUTE_PERCENT == saving_split::MAX_PERCENT );
 static constexpr symbol TOKEN_SYMBOL = symbol{"EOS", 4};
 static constexpr name TOKEN_CONTRACT = "eosio.token"_n;
 
@@ -25,6 +29,8 @@ public:
      * ## TABLE `config`
      *
      * - `{distribute_account} accounts` - configuration accounts (ex: [ {"account": "eosio.grants", "percent": 10000} ])
+     * - `{uint64_t} index` - cumulative amount received for distribution (claimer share is `index * percent / 10000`),
+     *   binary extension: absent in rows written before it was introduced (treated as 0)
      *
      * ### example
      *
@@ -32,12 +38,14 @@ public:
      * {
      *   "accounts": [
      *     {"account": "eosio.grants", "percent": 10000}
-     *   ]
+     *   ],
+     *   "index": 10000000
      * }
      * ```
      */
     struct [[eosio::table("config")]] config_row {
         std::vector<distribute_account>     accounts;
+        binary_extension<uint64_t>          index;
     };
     typedef eosio::singleton< "config"_n, config_row > config_table;
 
@@ -47,22 +55,29 @@ public:
      * ### params
      *
      * - `{name} account` - account that can claim the distribution
-     * - `{asset} balance` - current balance of the claimant account
+     * - `{asset} balance` - settled balance of the claimant account
+     * - `{uint64_t} index` - config `index` at which `balance` was last settled,
+     *   binary extension: absent in rows written before it was introduced (treated as 0)
+     *
+     * Pending balance is `balance + (config.index - index) * percent / 10000` (see `get_balance`).
+     * Configured accounts without a row are treated as `{balance: 0, index: 0}`.
      *
      * ### example
      *
      * ```json
      * {
      *     "account": "myaccount",
-     *     "balance": "100.0000 EOS"
+     *     "balance": "100.0000 EOS",
+     *     "index": 10000000
      * }
      * ```
      */
     struct [[eosio::table("claimers")]] claimers_row {
-        name        account;
-        asset       balance;
+        name                            account;
+        asset                           balance;
+        binary_extension<uint64_t>      index;
 
-        uint64_t    primary_key() const { return account.value; }
+        uint64_t primary_key() const { return account.value; }
     };
     typedef eosio::multi_index< "claimers"_n, claimers_row> claimers_table;
 
@@ -83,7 +98,7 @@ public:
      *
      * @pre `claimer` has tokens to claim
      *
-     * @post row in `claimers` table will be erased
+     * @post row in `claimers` table balance will be set to zero
      * */
     [[eosio::action]]
     void claim( const name& claimer );
@@ -99,7 +114,24 @@ public:
 
     static asset get_balance( const name account, const name contract = "eosio.saving"_n ) {
         claimers_table claimers( contract, contract.value );
+        config_table config( contract, contract.value );
         const auto itr = claimers.find( account.value );
-        return itr != claimers.end() ? itr->balance : asset{0, TOKEN_SYMBOL};
+        const claimers_row claimer = itr != claimers.end() ? *itr : claimers_row{ account, asset{0, TOKEN_SYMBOL} };
+        return get_pending_balance( claimer, config.get_or_default() );
+    }
+
+    /**
+     * Settled balance plus the claimer share of everything received since it was last settled.
+     */
+    static asset get_pending_balance( const claimers_row& claimer, const config_row& config ) {
+        const uint64_t index_delta = config.index.value_or(0) - claimer.index.value_or(0);
+        return claimer.balance + asset{ saving_split::claimer_share( index_delta, get_percent( config, claimer.account ) ), TOKEN_SYMBOL };
+    }
+
+    static uint16_t get_percent( const config_row& config, const name account ) {
+        for ( const distribute_account& dist_row : config.accounts ) {
+            if ( dist_row.account == account ) return dist_row.percent;
+        }
+        return 0;
     }
 };
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Claim math of the `eosio.saving` contract (see `include/eosio.reward/split.hpp`).
+ */
+namespace saving_split {
+
+    static constexpr uint64_t MAX_PERCENT = 100'00; // 100%
+
+    /**
+     * Claimer share of the amount received since it was last settled (rounded down).
+     *
+     * @param index_delta - `config.index - claimer.index`
+     * @param percent - claimer percentage (1% == 100)
+     * @return int64_t - share amount
+     */
+    constexpr int64_t claimer_share( const uint64_t index_delta, const uint16_t percent ) {
+        if ( index_delta <= UINT64_MAX / MAX_PERCENT ) return static_cast<int64_t>( index_delta * percent / MAX_PERCENT );
+        return static_cast<int64_t>( static_cast<unsigned __int128>(index_delta) * percent / MAX_PERCENT );
+    }
+
+} /// namespace saving_split
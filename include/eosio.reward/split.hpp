@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstdint>
+
+/**
+ * Payout math of the `eosio.reward` contract.
+ *
+ * Header-only and free of any `eosio` dependency so the same code is compiled
+ * into the contracts and into the native fuzzer/benchmarks (see `native/`), this
+ * also applies to the claim math in `eosio.saving/eosio.saving.split.hpp`.
+ */
+namespace eosio::split {
+
+    /**
+     * Amount of `quantity` for `weight` out of `total_weight` (rounded down).
+     *
+     * Uses 64-bit arithmetic when `quantity * weight` fits, otherwise falls back
+     * to 128-bit (which is a library call in wasm).
+     *
+     * @param quantity - amount to split (non-negative)
+     * @param weight - weight of the share
+     * @param total_weight - total weight (`weight <= total_weight`)
+     * @return int64_t - share amount (0 if `total_weight` is 0)
+     */
+    constexpr int64_t split_amount( const int64_t quantity, const uint64_t weight, const uint64_t total_weight ) {
+        if ( quantity <= 0 || weight == 0 || total_weight == 0 ) return 0;
+
+        const uint64_t amount = static_cast<uint64_t>(quantity);
+        if ( amount <= UINT64_MAX / weight ) return static_cast<int64_t>( amount * weight / total_weight );
+        return static_cast<int64_t>( static_cast<unsigned __int128>(amount) * weight / total_weight );
+    }
+
+    /**
+     * Amounts sent to each strategy when distributing `quantity`.
+     *
+     * Amounts below `min_quantity` and amounts of strategies that cannot be paid
+     * (ex: `recipients` without any recipient) are 0 and kept for the next distribution.
+     *
+     * @param strategies - strategies in distribution order (rows with `weight`)
+     * @param total_weight - total weight of all strategies
+     * @param quantity - amount to distribute
+     * @param min_quantity - minimum amount sent to a strategy
+     * @param payable - called with each row, false to keep its share
+     * @param amount - called with `(row, amount)` for each strategy, in order
+     * @return int64_t - dust (`quantity` not sent to any strategy)
+     */
+    template <typename Strategies, typename Payable, typename Amount>
+    int64_t strategy_amounts( const Strategies& strategies, const uint64_t total_weight, const int64_t quantity, const int64_t min_quantity, Payable&& payable, Amount&& amount ) {
+        int64_t dust = quantity;
+        for ( const auto& row : strategies ) {
+            int64_t share = split_amount( quantity, row.weight, total_weight );
+            if ( share < min_quantity || !payable( row ) ) share = 0;
+            dust -= share;
+            amount( row, share );
+        }
+        return dust;
+    }
+
+    /**
+     * Pay the next batch of recipients of a paged strategy.
+     *
+     * @param recipients - recipients ordered by account (`lower_bound`, `end`, rows with `account.value` and `weight`)
+     * @param cursor - next recipient account value, advanced past every visited recipient
+     * @param count - recipients visited in the current batch, incremented up to `limit`
+     * @param limit - maximum number of recipients per batch
+     * @param quantity - amount of the strategy snapshot
+     * @param total_weight - total recipient weight snapshot
+     * @param pay - called with `(row, amount)` for each non-zero amount
+     * @return bool - true when all recipients have been visited
+     */
+    template <typename Table, typename Pay>
+    bool pay_batch( const Table& recipients, uint64_t& cursor, uint32_t& count, const uint32_t limit, const int64_t quantity, const uint64_t total_weight, Pay&& pay ) {
+        auto itr = recipients.lower_bound( cursor );
+        for ( ; itr != recipients.end() && count < limit; ++itr, ++count ) {
+            cursor = itr->account.value + 1;
+            const int64_t amount = split_amount( quantity, itr->weight, total_weight );
+            if ( amount > 0 ) pay( *itr, amount );
+        }
+        return itr == recipients.end();
+    }
+
+} /// namespace eosio::split
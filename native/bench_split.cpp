@@ -0,0 +1,92 @@
+#include <eosio.reward/split.hpp>
+#include <eosio.saving/eosio.saving.split.hpp>
+
+#include "mock_multi_index.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <vector>
+
+// Microbenchmarks for the payout math shared with the contracts.
+//
+// usage: bench_split
+
+namespace {
+
+    struct strategy_weight {
+        uint16_t    weight;
+    };
+
+    struct recipients_row {
+        mock::name  account;
+        uint16_t    weight;
+
+        uint64_t primary_key() const { return account.value; }
+    };
+
+    volatile int64_t sink;
+
+    template <typename Fn>
+    void bench( const char* label, const uint64_t iterations, Fn&& fn ) {
+        const auto start = std::chrono::steady_clock::now();
+        int64_t total = 0;
+        for ( uint64_t i = 0; i < iterations; ++i ) total += fn( i );
+        const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+        sink = total;
+        std::printf( "%-40s %10.2f ns/op\n", label, seconds * 1e9 / iterations );
+    }
+
+} // namespace
+
+int main() {
+    constexpr uint64_t ITERATIONS = 10'000'000;
+    constexpr int64_t MAX_AMOUNT = (1LL << 62) - 1;
+
+    // single share, 64-bit fast path vs 128-bit fallback
+    bench( "split_amount (64-bit)", ITERATIONS, []( const uint64_t i ) {
+        return eosio::split::split_amount( 10'000'0000 + static_cast<int64_t>(i), 90, 110 );
+    });
+    bench( "split_amount (128-bit)", ITERATIONS, []( const uint64_t i ) {
+        return eosio::split::split_amount( MAX_AMOUNT - static_cast<int64_t>(i), 65535, 65536 );
+    });
+
+    // all strategies of a distribution
+    for ( const uint32_t size : { 2u, 8u, 32u } ) {
+        std::vector<strategy_weight> strategies( size, { 100 } );
+        const uint64_t total_weight = 100ull * size;
+        char label[64];
+        std::snprintf( label, sizeof(label), "strategy_amounts (%u)", size );
+        bench( label, ITERATIONS / size, [&]( const uint64_t i ) {
+            int64_t distributed = 0;
+            eosio::split::strategy_amounts( strategies, total_weight, 1000'0000 + static_cast<int64_t>(i), 1, []( const strategy_weight& ) {
+                return true;
+            }, [&]( const strategy_weight&, const int64_t amount ) {
+                distributed += amount;
+            });
+            return distributed;
+        });
+    }
+
+    // one batch of recipients
+    mock::multi_index<recipients_row> recipients;
+    for ( uint64_t account = 1; account <= 1000; ++account ) {
+        recipients.emplace( mock::name{ account }, [&]( auto& row ) {
+            row.account = mock::name{ account };
+            row.weight = static_cast<uint16_t>( account % 100 + 1 );
+        });
+    }
+    bench( "pay_batch (50 of 1000 recipients)", ITERATIONS / 50, [&]( const uint64_t i ) {
+        uint64_t cursor = (i * 50) % 1000;
+        uint32_t count = 0;
+        int64_t paid = 0;
+        eosio::split::pay_batch( recipients, cursor, count, 50, 1000'0000, 50500, [&]( const recipients_row&, const int64_t amount ) {
+            paid += amount;
+        });
+        return paid;
+    });
+
+    bench( "claimer_share", ITERATIONS, []( const uint64_t i ) {
+        return saving_split::claimer_share( 1000'0000 + i, 2500 );
+    });
+    return 0;
+}
@@ -0,0 +1,196 @@
+#include <eosio.reward/split.hpp>
+#include <eosio.saving/eosio.saving.split.hpp>
+
+#include "mock_multi_index.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Differential fuzzer for the payout math shared with the contracts.
+//
+// usage: fuzz_split [iterations] [seed]
+//
+// Every random configuration is checked against a 128-bit reference model and for
+// conservation of funds (nothing is created, dust is bounded by the number of shares).
+
+namespace {
+
+    constexpr int64_t MAX_AMOUNT = (1LL << 62) - 1; // eosio::asset::max_amount
+    constexpr uint32_t MAX_STRATEGIES = 32;
+    constexpr uint32_t MAX_RECIPIENTS = 300;
+
+    struct strategy_weight {
+        uint16_t    weight;
+        bool        payable;    // false for `recipients` strategies without recipients
+    };
+
+    struct recipients_row {
+        mock::name  account;
+        uint16_t    weight;
+
+        uint64_t primary_key() const { return account.value; }
+    };
+
+    std::mt19937_64 rng;
+    uint64_t failures = 0;
+
+    int64_t reference_split( const int64_t quantity, const uint64_t weight, const uint64_t total_weight ) {
+        if ( total_weight == 0 ) return 0;
+        return static_cast<int64_t>( static_cast<__int128>(quantity) * static_cast<__int128>(weight) / static_cast<__int128>(total_weight) );
+    }
+
+    int64_t reference_share( const uint64_t index_delta, const uint16_t percent ) {
+        return static_cast<int64_t>( static_cast<__int128>(index_delta) * percent / 10000 );
+    }
+
+    void fail( const char* check, const int64_t quantity, const uint64_t a, const uint64_t b ) {
+        if ( failures++ < 10 ) {
+            std::fprintf( stderr, "FAIL %s quantity=%lld a=%llu b=%llu\n", check, static_cast<long long>(quantity), static_cast<unsigned long long>(a), static_cast<unsigned long long>(b) );
+        }
+    }
+
+    uint64_t random_below( const uint64_t bound ) {
+        return std::uniform_int_distribution<uint64_t>( 0, bound - 1 )( rng );
+    }
+
+    // bias towards the interesting ranges: dust, typical balances and close to asset::max_amount
+    int64_t random_quantity() {
+        switch ( random_below( 4 ) ) {
+            case 0: return static_cast<int64_t>( random_below( 100 ) );
+            case 1: return static_cast<int64_t>( random_below( 1'000'000'0000 ) );
+            case 2: return MAX_AMOUNT - static_cast<int64_t>( random_below( 1'000'000 ) );
+            default: return static_cast<int64_t>( random_below( static_cast<uint64_t>(MAX_AMOUNT) + 1 ) );
+        }
+    }
+
+    uint16_t random_weight() {
+        return random_below( 2 ) ? static_cast<uint16_t>( 1 + random_below( 100 ) ) : static_cast<uint16_t>( 1 + random_below( UINT16_MAX ) );
+    }
+
+    // `reward::get_strategy_amounts`
+    void fuzz_strategies() {
+        const uint32_t size = 1 + random_below( MAX_STRATEGIES );
+        std::vector<strategy_weight> strategies( size );
+        uint64_t total_weight = 0;
+        for ( auto& row : strategies ) {
+            row.weight = random_weight();
+            row.payable = random_below( 8 ) != 0;
+            total_weight += row.weight;
+        }
+        const int64_t quantity = random_quantity();
+        const int64_t min_quantity = random_below( 2 ) ? 0 : random_quantity() / static_cast<int64_t>( 1 + random_below( 64 ) );
+
+        int64_t distributed = 0;
+        int64_t kept = 0;
+        size_t index = 0;
+        const int64_t dust = eosio::split::strategy_amounts( strategies, total_weight, quantity, min_quantity, []( const strategy_weight& row ) {
+            return row.payable;
+        }, [&]( const strategy_weight& row, const int64_t amount ) {
+            if ( &row != &strategies[index++] ) fail( "strategy_amounts order", quantity, index, size );
+            const int64_t share = reference_split( quantity, row.weight, total_weight );
+            const int64_t expected = share >= min_quantity && row.payable ? share : 0;
+            if ( amount != expected ) fail( "strategy_amounts", quantity, row.weight, total_weight );
+            if ( amount != 0 && amount != eosio::split::split_amount( quantity, row.weight, total_weight ) ) fail( "split_amount", quantity, row.weight, total_weight );
+            distributed += amount;
+            kept += share - amount;
+        });
+        if ( index != size ) fail( "strategy_amounts size", quantity, index, size );
+        if ( dust != quantity - distributed ) fail( "strategy_amounts dust", quantity, dust, distributed );
+        if ( dust - kept < 0 || dust - kept >= static_cast<int64_t>(size) ) fail( "strategies conservation", quantity, size, total_weight );
+    }
+
+    // `reward::distribute_batch`
+    void fuzz_recipients() {
+        mock::multi_index<recipients_row> recipients;
+        const uint32_t size = 1 + random_below( MAX_RECIPIENTS );
+        uint64_t total_weight = 0;
+        while ( recipients.size() < size ) {
+            // the last possible account wraps the cursor (`value + 1`) on its last row
+            const mock::name account{ recipients.size() == 0 && random_below( 4 ) == 0 ? UINT64_MAX : rng() };
+            if ( recipients.find( account.value ) != recipients.end() ) continue;
+            const uint16_t weight = random_weight();
+            recipients.emplace( account, [&]( auto& row ) {
+                row.account = account;
+                row.weight = weight;
+            });
+            total_weight += weight;
+        }
+        const int64_t quantity = random_quantity();
+        const uint32_t limit = 1 + random_below( 64 );
+
+        // page through all recipients, each must be visited exactly once
+        std::map<uint64_t, uint32_t> visits;
+        int64_t paid = 0;
+        uint64_t cursor = 0;
+        bool completed = false;
+        uint32_t batches = 0;
+        while ( !completed ) {
+            uint32_t count = 0;
+            completed = eosio::split::pay_batch( recipients, cursor, count, limit, quantity, total_weight, [&]( const recipients_row& row, const int64_t amount ) {
+                if ( amount != reference_split( quantity, row.weight, total_weight ) ) fail( "pay_batch amount", quantity, row.weight, total_weight );
+                visits[row.account.value] += 1;
+                paid += amount;
+            });
+            if ( count > limit ) fail( "pay_batch limit", quantity, count, limit );
+            if ( ++batches > size + 1 ) {
+                fail( "pay_batch progress", quantity, batches, size );
+                return;
+            }
+        }
+        for ( auto itr = recipients.begin(); itr != recipients.end(); ++itr ) {
+            const bool expected = reference_split( quantity, itr->weight, total_weight ) > 0;
+            const auto visit = visits.find( itr->account.value );
+            const uint32_t times = visit == visits.end() ? 0 : visit->second;
+            if ( times != (expected ? 1u : 0u) ) fail( "pay_batch paid once", quantity, itr->account.value, times );
+        }
+        const int64_t dust = quantity - paid;
+        if ( dust < 0 || dust >= static_cast<int64_t>(size) ) fail( "recipients conservation", quantity, size, total_weight );
+    }
+
+    // `saving::get_pending_balance`
+    void fuzz_claimers() {
+        std::vector<uint16_t> percents;
+        uint32_t remaining = 10000;
+        while ( remaining > 0 ) {
+            const uint16_t percent = random_below( 4 ) ? static_cast<uint16_t>( 1 + random_below( remaining ) ) : static_cast<uint16_t>( remaining );
+            percents.push_back( percent );
+            remaining -= percent;
+        }
+        const uint64_t first = static_cast<uint64_t>( random_quantity() );
+        const uint64_t second = static_cast<uint64_t>( random_quantity() );
+        const uint64_t delta = first + second;
+
+        int64_t claimed = 0;
+        for ( const uint16_t percent : percents ) {
+            const int64_t share = saving_split::claimer_share( delta, percent );
+            if ( share != reference_share( delta, percent ) ) fail( "claimer_share", static_cast<int64_t>(delta), percent, 0 );
+
+            // settling in two steps never pays more than settling once
+            const int64_t split = saving_split::claimer_share( first, percent ) + saving_split::claimer_share( second, percent );
+            if ( split > share || share - split > 1 ) fail( "claimer_share additivity", static_cast<int64_t>(delta), percent, 0 );
+            claimed += share;
+        }
+        if ( claimed < 0 || static_cast<uint64_t>(claimed) > delta || delta - claimed >= percents.size() ) fail( "claimers conservation", static_cast<int64_t>(delta), percents.size(), 0 );
+    }
+
+} // namespace
+
+int main( int argc, char** argv ) {
+    const uint64_t iterations = argc > 1 ? std::strtoull( argv[1], nullptr, 10 ) : 1'000'000;
+    const uint64_t seed = argc > 2 ? std::strtoull( argv[2], nullptr, 10 ) : std::random_device{}();
+    rng.seed( seed );
+
+    const auto start = std::chrono::steady_clock::now();
+    for ( uint64_t i = 0; i < iterations; ++i ) {
+        fuzz_strategies();
+        fuzz_claimers();
+        if ( i % 64 == 0 ) fuzz_recipients();
+    }
+    const double seconds = std::chrono::duration<double>( std::chrono::steady_clock::now() - start ).count();
+
+    std::printf( "seed=%llu iterations=%llu configs/s=%.0f failures=%llu\n", static_cast<unsigned long long>(seed), static_cast<unsigned long long>(iterations), iterations / seconds, static_cast<unsigned long long>(failures) );
+    return failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <stdexcept>
+
+/**
+ * Minimal host-side stand-in for `eosio::multi_index` (primary index only).
+ *
+ * Only the members used by the shared payout headers and the native tests are provided.
+ */
+namespace mock {
+
+    struct name {
+        uint64_t value = 0;
+
+        friend bool operator<( const name a, const name b ) { return a.value < b.value; }
+        friend bool operator==( const name a, const name b ) { return a.value == b.value; }
+    };
+
+    template <typename Row>
+    class multi_index {
+    public:
+        class const_iterator {
+        public:
+            using base = typename std::map<uint64_t, Row>::const_iterator;
+
+            const_iterator() = default;
+            explicit const_iterator( base itr ) : _itr( itr ) {}
+
+            const Row& operator*() const { return _itr->second; }
+            const Row* operator->() const { return &_itr->second; }
+            const_iterator& operator++() { ++_itr; return *this; }
+            bool operator==( const const_iterator& other ) const { return _itr == other._itr; }
+            bool operator!=( const const_iterator& other ) const { return _itr != other._itr; }
+
+        private:
+            base _itr;
+        };
+
+        const_iterator begin() const { return const_iterator( _rows.begin() ); }
+        const_iterator end() const { return const_iterator( _rows.end() ); }
+        const_iterator find( const uint64_t primary ) const { return const_iterator( _rows.find( primary ) ); }
+        const_iterator lower_bound( const uint64_t primary ) const { return const_iterator( _rows.lower_bound( primary ) ); }
+        size_t size() const { return _rows.size(); }
+
+        template <typename Lambda>
+        const_iterator emplace( const name /* payer */, Lambda&& constructor ) {
+            Row row{};
+            constructor( row );
+            const auto result = _rows.emplace( row.primary_key(), row );
+            if ( !result.second ) throw std::logic_error( "could not insert object, most likely a uniqueness constraint was violated" );
+            return const_iterator( result.first );
+        }
+
+        void clear() { _rows.clear(); }
+
+    private:
+        std::map<uint64_t, Row> _rows;
+    };
+
+} /// namespace mock